@@ -0,0 +1,87 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <libgen.h>
+
+#include "atomic-file.h"
+
+bool _atomic_file_write_all(int fd, const void* data, size_t len) {
+  const char* bytes = data;
+  size_t written = 0;
+  while (written < len) {
+    ssize_t n = write(fd, bytes + written, len - written);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    written += n;
+  }
+  return true;
+}
+
+/**
+ * Syncs the directory holding path, which makes a rename or a newly created
+ * file in it durable.
+ */
+void _atomic_file_sync_dir(const char* path) {
+  char copy[4096];
+  snprintf(copy, sizeof(copy), "%s", path);
+  int fd = open(dirname(copy), O_RDONLY);
+  if (fd >= 0) {
+    fsync(fd);
+    close(fd);
+  }
+}
+
+/**
+ * Replaces path with data: the data is written and synced to a temporary
+ * file next to it, which is then renamed over the old one.
+ */
+bool atomic_file_write(const char* path, const void* data, size_t len) {
+  char temp[4096];
+  snprintf(temp, sizeof(temp), "%s.%d.tmp", path, (int)getpid());
+  int fd = open(temp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    return false;
+  }
+  bool ok = _atomic_file_write_all(fd, data, len) && fsync(fd) == 0;
+  ok = close(fd) == 0 && ok;
+  if (!ok || rename(temp, path) != 0) {
+    int saved = errno;
+    unlink(temp);
+    errno = saved;
+    return false;
+  }
+  _atomic_file_sync_dir(path);
+  return true;
+}
+
+/**
+ * Appends data to path. A path that doesn't exist yet is written whole,
+ * header first, so the file never exists without its header.
+ */
+bool atomic_file_append(const char* path, const void* header, size_t header_len,
+                        const void* data, size_t len) {
+  int fd = open(path, O_WRONLY | O_APPEND);
+  if (fd < 0 && errno == ENOENT) {
+    char* whole = malloc(header_len + len);
+    memcpy(whole, header, header_len);
+    memcpy(whole + header_len, data, len);
+    bool ok = atomic_file_write(path, whole, header_len + len);
+    int saved = errno;
+    free(whole);
+    errno = saved;
+    return ok;
+  }
+  if (fd < 0) {
+    return false;
+  }
+  bool ok = _atomic_file_write_all(fd, data, len) && fdatasync(fd) == 0;
+  ok = close(fd) == 0 && ok;
+  return ok;
+}
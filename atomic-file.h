@@ -0,0 +1,16 @@
+#ifndef ATOMIC_FILE_H
+#define ATOMIC_FILE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Crash-safe file writes */
+/* Both calls sync before they return true, so what they wrote survives a
+ * crash or power cut. Neither can leave a file half replaced; an append cut
+ * short leaves a torn tail, which readers have to detect.
+ */
+bool atomic_file_write(const char* path, const void* data, size_t len);
+bool atomic_file_append(const char* path, const void* header, size_t header_len,
+                        const void* data, size_t len);
+
+#endif
@@ -0,0 +1,72 @@
+
+#include <stdlib.h>
+#include <limits.h>
+
+#include "autopilot.h"
+
+/* Autopilot */
+/* A greedy bot for headless runs: head for the first berry, avoiding walls,
+ * the snake and missiles.
+ */
+
+typedef struct move {
+  GameInput input;
+  int dx;
+  int dy;
+} Move;
+
+const Move AUTOPILOT_MOVES[] = {
+  {GAME_INPUT_UP, 0, -1},
+  {GAME_INPUT_DOWN, 0, 1},
+  {GAME_INPUT_LEFT, -1, 0},
+  {GAME_INPUT_RIGHT, 1, 0}
+};
+
+GameInput autopilot_next_input(Game* game) {
+  Snake* snake = game->snake;
+  struct point* front = snake_front(snake);
+  Berry* target = game->berries->count > 0 ? &game->berries->berries[0] : NULL;
+
+  GameInput best = GAME_INPUT_NONE;
+  int best_distance = INT_MAX;
+  for (int i = 0; i < 4; i++) {
+    const Move* move = &AUTOPILOT_MOVES[i];
+    // The snake can't turn back on itself
+    if (move->dx == -snake->direction.dx && move->dy == -snake->direction.dy) {
+      continue;
+    }
+    int x = front->x + move->dx;
+    int y = front->y + move->dy;
+    if (x < 0 || x >= game->width || y < 0 || y >= game->height ||
+        snake_has_point_at(snake, x, y) || game_missile_at(game, x, y)) {
+      continue;
+    }
+    int distance = target == NULL ? 0 : abs(target->location.x - x) + abs(target->location.y - y);
+    if (distance < best_distance) {
+      best_distance = distance;
+      best = move->input;
+    }
+  }
+  return best;
+}
+
+/**
+ * Plays the game until it is over or max_ticks have run. Returns the ticks run.
+ */
+unsigned long autopilot_play(Game* game, unsigned long max_ticks) {
+  // Only steer once per snake move
+  unsigned long last_snake_tick = ULONG_MAX;
+  unsigned long ticks = 0;
+  while (!game->gameOver && ticks < max_ticks) {
+    if (game->lastSnakeTick != last_snake_tick) {
+      last_snake_tick = game->lastSnakeTick;
+      game_handle_input(game, autopilot_next_input(game));
+    }
+    unsigned long run = game_advance(game, max_ticks - ticks);
+    if (run == 0) {
+      break;
+    }
+    ticks += run;
+  }
+  return ticks;
+}
@@ -0,0 +1,12 @@
+#ifndef AUTOPILOT_H
+#define AUTOPILOT_H
+
+#include "game.h"
+
+/* Longest game autopilot_play will run, in ticks (10 minutes of game time) */
+#define AUTOPILOT_MAX_GAME_TICKS 600000
+
+GameInput autopilot_next_input(Game*);
+unsigned long autopilot_play(Game*, unsigned long max_ticks);
+
+#endif
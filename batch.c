@@ -0,0 +1,170 @@
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "game.h"
+#include "autopilot.h"
+
+/* Batch simulation */
+/* Holds many independent game instances, each with its own RNG stream, and
+ * plays them with the autopilot on every core. Each instance is one task.
+ * Tasks are dealt round-robin onto per-worker deques. A worker pops its own
+ * deque from the bottom and, once that is empty, steals from the top of the
+ * other workers' deques, so uneven game lengths don't leave cores idle.
+ */
+
+#define BATCH_DEFAULT_INSTANCES 1024
+#define BATCH_DEFAULT_GAMES 4
+
+struct batch;
+
+typedef struct worker {
+  pthread_t thread;
+  int id;
+  struct batch* batch;
+  // Deque of instance indices; owner takes from bottom, thieves from top
+  pthread_mutex_t lock;
+  int* tasks;
+  int top;
+  int bottom;
+  // Totals for the games this worker played
+  unsigned long games;
+  unsigned long ticks;
+  unsigned long score;
+} Worker;
+
+typedef struct batch {
+  Game** games;
+  int num_instances;
+  int games_per_instance;
+  Worker* workers;
+  int num_workers;
+} Batch;
+
+bool worker_pop(Worker* worker, int* task) {
+  bool found = false;
+  pthread_mutex_lock(&worker->lock);
+  if (worker->bottom > worker->top) {
+    *task = worker->tasks[--worker->bottom];
+    found = true;
+  }
+  pthread_mutex_unlock(&worker->lock);
+  return found;
+}
+
+bool worker_steal(Worker* victim, int* task) {
+  bool found = false;
+  pthread_mutex_lock(&victim->lock);
+  if (victim->bottom > victim->top) {
+    *task = victim->tasks[victim->top++];
+    found = true;
+  }
+  pthread_mutex_unlock(&victim->lock);
+  return found;
+}
+
+/**
+ * Gets the next task, stealing if this worker has run out. Tasks are never
+ * added once the batch starts, so finding every deque empty means we're done.
+ */
+bool worker_next_task(Worker* worker, int* task) {
+  if (worker_pop(worker, task)) {
+    return true;
+  }
+  Batch* batch = worker->batch;
+  for (int i = 1; i < batch->num_workers; i++) {
+    Worker* victim = &batch->workers[(worker->id + i) % batch->num_workers];
+    if (worker_steal(victim, task)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void* worker_run(void* data) {
+  Worker* worker = (Worker*)data;
+  Batch* batch = worker->batch;
+  int task;
+  while (worker_next_task(worker, &task)) {
+    Game* game = batch->games[task];
+    for (int i = 0; i < batch->games_per_instance; i++) {
+      worker->ticks += autopilot_play(game, AUTOPILOT_MAX_GAME_TICKS);
+      worker->score += game_score(game);
+      worker->games++;
+      game_reset(game);
+    }
+  }
+  return NULL;
+}
+
+double batch_seconds() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+int main(int argc, char** argv) {
+  Batch batch;
+  batch.num_instances = argc > 1 ? atoi(argv[1]) : BATCH_DEFAULT_INSTANCES;
+  batch.games_per_instance = argc > 2 ? atoi(argv[2]) : BATCH_DEFAULT_GAMES;
+  batch.num_workers = argc > 3 ? atoi(argv[3]) : sysconf(_SC_NPROCESSORS_ONLN);
+  uint64_t seed = argc > 4 ? strtoull(argv[4], NULL, 10) : (uint64_t)time(NULL);
+  if (batch.num_instances <= 0 || batch.games_per_instance <= 0 || batch.num_workers <= 0) {
+    fprintf(stderr, "Usage: %s [instances] [games-per-instance] [threads] [seed]\n", argv[0]);
+    return 1;
+  }
+
+  // Every instance gets its own seed, and so its own random stream. Results
+  // depend only on the seed, not on how instances were spread over threads.
+  batch.games = malloc(sizeof(Game*) * batch.num_instances);
+  for (int i = 0; i < batch.num_instances; i++) {
+    batch.games[i] = game_init(50, 50, seed + i);
+  }
+
+  batch.workers = calloc(batch.num_workers, sizeof(Worker));
+  for (int i = 0; i < batch.num_workers; i++) {
+    Worker* worker = &batch.workers[i];
+    worker->id = i;
+    worker->batch = &batch;
+    pthread_mutex_init(&worker->lock, NULL);
+    worker->tasks = malloc(sizeof(int) * (batch.num_instances / batch.num_workers + 1));
+  }
+  for (int i = 0; i < batch.num_instances; i++) {
+    Worker* worker = &batch.workers[i % batch.num_workers];
+    worker->tasks[worker->bottom++] = i;
+  }
+
+  double start = batch_seconds();
+  for (int i = 0; i < batch.num_workers; i++) {
+    pthread_create(&batch.workers[i].thread, NULL, worker_run, &batch.workers[i]);
+  }
+  unsigned long games = 0, ticks = 0, score = 0;
+  for (int i = 0; i < batch.num_workers; i++) {
+    Worker* worker = &batch.workers[i];
+    pthread_join(worker->thread, NULL);
+    games += worker->games;
+    ticks += worker->ticks;
+    score += worker->score;
+  }
+  double elapsed = batch_seconds() - start;
+
+  printf("seed: %llu instances: %d threads: %d games: %lu ticks: %lu seconds: %.3f "
+         "games/s: %.0f ticks/s: %.0f mean score: %.1f\n",
+         (unsigned long long)seed, batch.num_instances, batch.num_workers, games, ticks, elapsed,
+         games / elapsed, ticks / elapsed, (double)score / games);
+
+  for (int i = 0; i < batch.num_workers; i++) {
+    pthread_mutex_destroy(&batch.workers[i].lock);
+    free(batch.workers[i].tasks);
+  }
+  free(batch.workers);
+  for (int i = 0; i < batch.num_instances; i++) {
+    game_free(batch.games[i]);
+  }
+  free(batch.games);
+  return 0;
+}
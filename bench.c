@@ -0,0 +1,361 @@
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <limits.h>
+
+#include "game.h"
+#include "autopilot.h"
+#include "hash.h"
+#include "leaderboard.h"
+
+/* Benchmarks */
+/* Times the hot paths of the simulation core and prints one JSON object per
+ * benchmark, one per line:
+ *   {"bench": name, "param": setup, "ops": ops timed, "ns_per_op": mean,
+ *    "p50": ..., "p90": ..., "p99": ..., "max": ..., "allocs_per_op": ...}
+ * Ops are timed in batches big enough for the clock to resolve; percentiles
+ * are over the per-op time of each batch. Allocations are counted by wrapping
+ * malloc, calloc and realloc at link time (see the bench target).
+ * Usage: snake-bench [name filter]
+ */
+
+#define BENCH_SAMPLES 1000
+// A batch has to take at least this long to be timed
+#define BENCH_MIN_BATCH_NS 20000
+
+// Board loop the snake benchmarks drive the snake around, clear of the edges
+#define BENCH_LOOP_MIN 8
+#define BENCH_LOOP_MAX 41
+
+/* Allocation counting */
+unsigned long bench_allocations = 0;
+
+void* __real_malloc(size_t);
+void* __real_calloc(size_t, size_t);
+void* __real_realloc(void*, size_t);
+
+void* __wrap_malloc(size_t size) {
+  bench_allocations++;
+  return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+  bench_allocations++;
+  return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+  bench_allocations++;
+  return __real_realloc(ptr, size);
+}
+
+/* Harness */
+typedef void (*BenchOp)(void* data);
+
+double bench_now_ns() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+int _bench_compare_doubles(const void* a, const void* b) {
+  double x = *(const double*)a;
+  double y = *(const double*)b;
+  return (x > y) - (x < y);
+}
+
+/**
+ * Runs op in timed batches and prints the results as a JSON line
+ */
+void bench_run(const char* name, const char* param, BenchOp op, void* data) {
+  // Grow the batch until it is long enough to time
+  unsigned long batch = 1;
+  while (true) {
+    double start = bench_now_ns();
+    for (unsigned long i = 0; i < batch; i++) {
+      op(data);
+    }
+    if (bench_now_ns() - start >= BENCH_MIN_BATCH_NS || batch >= (1UL << 24)) {
+      break;
+    }
+    batch *= 2;
+  }
+
+  double samples[BENCH_SAMPLES];
+  double total = 0;
+  unsigned long allocations = bench_allocations;
+  for (int s = 0; s < BENCH_SAMPLES; s++) {
+    double start = bench_now_ns();
+    for (unsigned long i = 0; i < batch; i++) {
+      op(data);
+    }
+    double elapsed = bench_now_ns() - start;
+    samples[s] = elapsed / batch;
+    total += elapsed;
+  }
+  allocations = bench_allocations - allocations;
+  unsigned long ops = batch * BENCH_SAMPLES;
+
+  qsort(samples, BENCH_SAMPLES, sizeof(double), _bench_compare_doubles);
+  printf("{\"bench\": \"%s\", \"param\": \"%s\", \"ops\": %lu, \"ns_per_op\": %.2f, "
+         "\"p50\": %.2f, \"p90\": %.2f, \"p99\": %.2f, \"max\": %.2f, \"allocs_per_op\": %.3f}\n",
+         name, param, ops, total / ops,
+         samples[BENCH_SAMPLES / 2], samples[BENCH_SAMPLES * 9 / 10],
+         samples[BENCH_SAMPLES * 99 / 100], samples[BENCH_SAMPLES - 1],
+         (double)allocations / ops);
+  fflush(stdout);
+}
+
+/* Setup helpers */
+
+/**
+ * Points the snake along a loop around the board, joining it from the
+ * starting position, so it can move forever without dying.
+ */
+void bench_steer(Snake* snake) {
+  struct point* front = snake_front(snake);
+  snake->direction = (struct direction){-1, 0};
+  if (front->x == BENCH_LOOP_MIN && front->y < BENCH_LOOP_MAX) {
+    snake->direction = (struct direction){0, 1};
+  } else if (front->y == BENCH_LOOP_MAX && front->x < BENCH_LOOP_MAX) {
+    snake->direction = (struct direction){1, 0};
+  } else if (front->x == BENCH_LOOP_MAX && front->y > BENCH_LOOP_MIN) {
+    snake->direction = (struct direction){0, -1};
+  }
+}
+
+/**
+ * A game with the snake on the loop, grown to length
+ */
+Game* bench_game_with_snake(int length) {
+  Game* game = game_init(50, 50, 1);
+  game_reset_missiles(game);
+  // Get the whole snake onto the loop first; growing extends the tail
+  for (int i = 0; i < 2 * BENCH_LOOP_MAX; i++) {
+    bench_steer(game->snake);
+    snake_go(game->snake);
+  }
+  // Moving then growing leaves the tail where it was, one cell longer
+  while (game->snake->num_points < length) {
+    bench_steer(game->snake);
+    snake_go(game->snake);
+    snake_grow(game->snake);
+  }
+  game_reset_free_cells(game);
+  return game;
+}
+
+/* Benchmarks */
+
+void bench_snake_go(void* data) {
+  Snake* snake = ((Game*)data)->snake;
+  bench_steer(snake);
+  snake_go(snake);
+}
+
+void bench_snake_check_dead(void* data) {
+  Game* game = (Game*)data;
+  if (snake_check_dead(game->snake, game)) {
+    abort();
+  }
+}
+
+typedef struct bench_hash {
+  struct hash* hash;
+  char (*keys)[16];
+  int num_keys;
+  int next;
+} BenchHash;
+
+void bench_hash_at(void* data) {
+  BenchHash* bench = (BenchHash*)data;
+  if (hash_at(bench->hash, bench->keys[bench->next]) == NULL) {
+    abort();
+  }
+  bench->next = (bench->next + 1) % bench->num_keys;
+}
+
+void bench_hash_at_missing(void* data) {
+  BenchHash* bench = (BenchHash*)data;
+  if (hash_at(bench->hash, "missing") != NULL) {
+    abort();
+  }
+}
+
+void bench_hash_add_delete(void* data) {
+  BenchHash* bench = (BenchHash*)data;
+  // The key is copied into the table's arena, so this shouldn't allocate
+  hash_add(bench->hash, "added", bench);
+  hash_delete(bench->hash, "added");
+}
+
+void bench_add_random_berry(void* data) {
+  Game* game = (Game*)data;
+  game_add_random_berry(game);
+  Berry* berry = &game->berries->berries[game->berries->count - 1];
+  game_remove_berry(game, berry->location.x, berry->location.y);
+}
+
+typedef struct bench_missiles {
+  Game* game;
+  int count;
+} BenchMissiles;
+
+void bench_update_missiles(void* data) {
+  BenchMissiles* bench = (BenchMissiles*)data;
+  game_update_missile_stuff(bench->game);
+  // Replace the missiles that flew off the top
+  while (bench->game->missiles->count < bench->count) {
+    game_add_missile(bench->game);
+  }
+}
+
+typedef struct bench_play {
+  Game* game;
+  unsigned long last_snake_tick;
+} BenchPlay;
+
+void _bench_play_steer(BenchPlay* bench) {
+  Game* game = bench->game;
+  if (game->gameOver) {
+    game_reset(game);
+  }
+  if (game->lastSnakeTick != bench->last_snake_tick) {
+    bench->last_snake_tick = game->lastSnakeTick;
+    game_handle_input(game, autopilot_next_input(game));
+  }
+}
+
+void bench_game_step(void* data) {
+  BenchPlay* bench = (BenchPlay*)data;
+  _bench_play_steer(bench);
+  game_step(bench->game, GAME_INPUT_NONE);
+}
+
+void bench_game_advance(void* data) {
+  BenchPlay* bench = (BenchPlay*)data;
+  _bench_play_steer(bench);
+  game_advance(bench->game, ULONG_MAX);
+}
+
+typedef struct bench_leaderboard {
+  Leaderboard* board;
+  Rng rng;
+} BenchLeaderboard;
+
+void bench_leaderboard_insert(void* data) {
+  BenchLeaderboard* bench = (BenchLeaderboard*)data;
+  // The board is full, so every insert also drops the worst entry
+  leaderboard_insert(bench->board, "AAA", rng_below(&bench->rng, 100000));
+}
+
+void bench_leaderboard_rank(void* data) {
+  BenchLeaderboard* bench = (BenchLeaderboard*)data;
+  leaderboard_rank(bench->board, rng_below(&bench->rng, 100000));
+}
+
+bool bench_selected(const char* filter, const char* name) {
+  return filter == NULL || strstr(name, filter) != NULL;
+}
+
+int main(int argc, char** argv) {
+  const char* filter = argc > 1 ? argv[1] : NULL;
+  char param[64];
+
+  if (bench_selected(filter, "snake_go")) {
+    Game* game = bench_game_with_snake(7);
+    bench_run("snake_go", "length=7", bench_snake_go, game);
+    game_free(game);
+  }
+
+  if (bench_selected(filter, "snake_check_dead")) {
+    int lengths[] = {7, 120};
+    for (int i = 0; i < 2; i++) {
+      Game* game = bench_game_with_snake(lengths[i]);
+      snprintf(param, sizeof(param), "length=%d", lengths[i]);
+      bench_run("snake_check_dead", param, bench_snake_check_dead, game);
+      game_free(game);
+    }
+  }
+
+  if (bench_selected(filter, "hash")) {
+    BenchHash bench;
+    bench.hash = hash_init();
+    bench.num_keys = 1024;
+    bench.keys = malloc(sizeof(*bench.keys) * bench.num_keys);
+    bench.next = 0;
+    for (int i = 0; i < bench.num_keys; i++) {
+      snprintf(bench.keys[i], sizeof(bench.keys[i]), "%d,%d", i % 50, i / 50);
+      hash_add(bench.hash, bench.keys[i], &bench);
+    }
+    snprintf(param, sizeof(param), "keys=%d", bench.num_keys);
+    bench_run("hash_at", param, bench_hash_at, &bench);
+    bench_run("hash_at_missing", param, bench_hash_at_missing, &bench);
+    bench_run("hash_add_delete", param, bench_hash_add_delete, &bench);
+    hash_free(bench.hash);
+    free(bench.keys);
+  }
+
+  if (bench_selected(filter, "game_add_random_berry")) {
+    int occupancies[] = {10, 50, 90};
+    for (int i = 0; i < 3; i++) {
+      Game* game = game_init(50, 50, 1);
+      // Take cells out of play until only the rest are free
+      int cells = game->width * game->height;
+      while (game->free_cells->count > cells * (100 - occupancies[i]) / 100) {
+        struct point cell = cell_set_at(game->free_cells, game_rand(game, game->free_cells->count));
+        cell_set_remove(game->free_cells, cell.x, cell.y);
+      }
+      snprintf(param, sizeof(param), "occupancy=%d%%", occupancies[i]);
+      bench_run("game_add_random_berry", param, bench_add_random_berry, game);
+      game_free(game);
+    }
+  }
+
+  if (bench_selected(filter, "game_update_missile_stuff")) {
+    int counts[] = {3, 30, 300};
+    for (int i = 0; i < 3; i++) {
+      BenchMissiles bench = {bench_game_with_snake(7), counts[i]};
+      Game* game = bench.game;
+      // Spread the missiles over the board, as if they had been flying a while
+      while (game->missiles->count < bench.count) {
+        int x = game_rand(game, game->width);
+        int y = game_rand(game, game->height);
+        if (missile_pool_add(game->missiles, x, y)) {
+          game->missile_exists[y * game->width + x]++;
+        }
+      }
+      snprintf(param, sizeof(param), "missiles=%d", counts[i]);
+      bench_run("game_update_missile_stuff", param, bench_update_missiles, &bench);
+      game_free(game);
+    }
+  }
+
+  if (bench_selected(filter, "game_step")) {
+    BenchPlay bench = {game_init(50, 50, 1), ULONG_MAX};
+    bench_run("game_step", "autopilot,tick", bench_game_step, &bench);
+    game_free(bench.game);
+  }
+
+  if (bench_selected(filter, "game_advance")) {
+    BenchPlay bench = {game_init(50, 50, 1), ULONG_MAX};
+    bench_run("game_advance", "autopilot,event", bench_game_advance, &bench);
+    game_free(bench.game);
+  }
+
+  if (bench_selected(filter, "leaderboard")) {
+    int entries = 100000;
+    BenchLeaderboard bench = {leaderboard_init(entries)};
+    rng_seed(&bench.rng, 1);
+    for (int i = 0; i < entries; i++) {
+      leaderboard_insert(bench.board, "AAA", rng_below(&bench.rng, 100000));
+    }
+    snprintf(param, sizeof(param), "entries=%d", entries);
+    bench_run("leaderboard_insert", param, bench_leaderboard_insert, &bench);
+    bench_run("leaderboard_rank", param, bench_leaderboard_rank, &bench);
+    leaderboard_free(bench.board);
+  }
+  return 0;
+}
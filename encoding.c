@@ -0,0 +1,23 @@
+#include "encoding.h"
+
+/**
+ * 32-bit FNV-1a
+ */
+uint32_t encoding_checksum(const unsigned char* data, size_t len) {
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < len; i++) {
+    hash ^= data[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+void encoding_put_u32(unsigned char* out, uint32_t value) {
+  for (int i = 0; i < 4; i++) {
+    out[i] = (value >> (8 * i)) & 0xff;
+  }
+}
+
+uint32_t encoding_get_u32(const unsigned char* in) {
+  return in[0] | in[1] << 8 | in[2] << 16 | (uint32_t)in[3] << 24;
+}
@@ -0,0 +1,16 @@
+#ifndef ENCODING_H
+#define ENCODING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* On-disk encoding */
+/* What the score files share: numbers as 4 little-endian bytes, whatever
+ * the host's byte order, and FNV-1a checksums over records and headers.
+ */
+
+uint32_t encoding_checksum(const unsigned char* data, size_t len);
+void encoding_put_u32(unsigned char* out, uint32_t value);
+uint32_t encoding_get_u32(const unsigned char* in);
+
+#endif
@@ -0,0 +1,63 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "font-cache.h"
+#include "hash.h"
+#include "profile.h"
+#include "log.h"
+
+/* Font cache */
+/* Fonts are opened once per (path, size) and shared by everything that draws
+ * text. Load the fonts you need at startup with font_cache_load, so a missing
+ * font is reported once instead of failing on every repaint.
+ */
+
+struct hash* font_cache = NULL;
+
+void _font_cache_key(char* key, size_t len, const char* path, int size) {
+  snprintf(key, len, "%d:%s", size, path);
+}
+
+/**
+ * Returns the cached font, opening it on first use. Returns NULL if it can't be opened.
+ */
+TTF_Font* font_cache_get(const char* path, int size) {
+  if (font_cache == NULL) {
+    font_cache = hash_init();
+  }
+  char key[512];
+  _font_cache_key(key, sizeof(key), path, size);
+  TTF_Font* font = (TTF_Font*)hash_at(font_cache, key);
+  if (font == NULL) {
+    font = TTF_OpenFont(path, size);
+    PROFILE_COUNT(PROFILE_FONT_OPENS, 1);
+    if (font == NULL) {
+      return NULL;
+    }
+    hash_add(font_cache, key, font);
+  }
+  return font;
+}
+
+bool font_cache_load(const char* path, int size) {
+  if (font_cache_get(path, size) == NULL) {
+    log_error("Unable to load font %s (size %d): %s", path, size, TTF_GetError());
+    return false;
+  }
+  return true;
+}
+
+void font_cache_free() {
+  if (font_cache == NULL) {
+    return;
+  }
+  int index = 0;
+  const char* key;
+  void* font;
+  while (hash_next(font_cache, &index, &key, &font)) {
+    TTF_CloseFont((TTF_Font*)font);
+  }
+  hash_free(font_cache);
+  font_cache = NULL;
+}
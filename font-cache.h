@@ -0,0 +1,13 @@
+#ifndef FONT_CACHE_H
+#define FONT_CACHE_H
+
+#include <stdbool.h>
+#include <SDL/SDL_ttf.h>
+
+#define FONT_PATH "/usr/share/fonts/truetype/ttf-dejavu/DejaVuSansMono.ttf"
+
+bool font_cache_load(const char* path, int size);
+TTF_Font* font_cache_get(const char* path, int size);
+void font_cache_free();
+
+#endif
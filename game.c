@@ -0,0 +1,851 @@
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <assert.h>
+
+#include "game.h"
+
+/* Berry grid */
+/* Berries are stored in a compact list for iteration, plus a per-cell index
+ * into that list for lookups by location. Removal swaps the last berry into
+ * the freed slot, so the list stays dense.
+ */
+BerryGrid* berry_grid_init(int width, int height) {
+  BerryGrid* grid = malloc(sizeof(struct berry_grid));
+  grid->width = width;
+  grid->height = height;
+  grid->index_at = malloc(sizeof(int) * width * height);
+  // At most one berry per cell
+  grid->berries = malloc(sizeof(Berry) * width * height);
+  grid->count = 0;
+  for (int i = 0; i < width * height; i++) {
+    grid->index_at[i] = -1;
+  }
+  return grid;
+}
+
+int* _berry_grid_index_at(BerryGrid* grid, int x, int y) {
+  if (x < 0 || x >= grid->width || y < 0 || y >= grid->height) {
+    return NULL;
+  }
+  return &grid->index_at[y * grid->width + x];
+}
+
+Berry* berry_grid_at(BerryGrid* grid, int x, int y) {
+  int* index = _berry_grid_index_at(grid, x, y);
+  if (index == NULL || *index < 0) {
+    return NULL;
+  }
+  return &grid->berries[*index];
+}
+
+/**
+ * Adds a berry at x,y, or returns the berry already there
+ */
+Berry* berry_grid_add(BerryGrid* grid, int x, int y) {
+  int* index = _berry_grid_index_at(grid, x, y);
+  assert(index != NULL);
+  if (*index >= 0) {
+    return &grid->berries[*index];
+  }
+  *index = grid->count++;
+  Berry* berry = &grid->berries[*index];
+  berry->location.x = x;
+  berry->location.y = y;
+  berry->hyper = false;
+  berry->added_during_hyper = false;
+  return berry;
+}
+
+bool berry_grid_remove(BerryGrid* grid, int x, int y) {
+  int* index = _berry_grid_index_at(grid, x, y);
+  if (index == NULL || *index < 0) {
+    return false; // Not Found
+  }
+  // Move the last berry into the freed slot
+  int removed = *index;
+  Berry* last = &grid->berries[--grid->count];
+  if (removed != grid->count) {
+    grid->berries[removed] = *last;
+    *_berry_grid_index_at(grid, last->location.x, last->location.y) = removed;
+  }
+  *index = -1;
+  return true;
+}
+
+void berry_grid_reset(BerryGrid* grid) {
+  for (int i = 0; i < grid->count; i++) {
+    Berry* berry = &grid->berries[i];
+    *_berry_grid_index_at(grid, berry->location.x, berry->location.y) = -1;
+  }
+  grid->count = 0;
+}
+
+void berry_grid_free(BerryGrid* grid) {
+  free(grid->index_at);
+  free(grid->berries);
+  free(grid);
+}
+
+/* Cell set */
+/* Members are packed into an array (removal swaps the last member into the
+ * hole) and each cell remembers its position in that array.
+ */
+CellSet* cell_set_init(int width, int height) {
+  CellSet* set = malloc(sizeof(struct cell_set));
+  set->width = width;
+  set->height = height;
+  set->cells = malloc(sizeof(int) * width * height);
+  set->position_of = malloc(sizeof(int) * width * height);
+  set->count = 0;
+  for (int i = 0; i < width * height; i++) {
+    set->position_of[i] = -1;
+  }
+  return set;
+}
+
+void cell_set_add(CellSet* set, int x, int y) {
+  int cell = y * set->width + x;
+  if (set->position_of[cell] < 0) {
+    set->position_of[cell] = set->count;
+    set->cells[set->count++] = cell;
+  }
+}
+
+void cell_set_remove(CellSet* set, int x, int y) {
+  int cell = y * set->width + x;
+  int position = set->position_of[cell];
+  if (position < 0) {
+    return;
+  }
+  int last = set->cells[--set->count];
+  set->cells[position] = last;
+  set->position_of[last] = position;
+  set->position_of[cell] = -1;
+}
+
+/**
+ * Adds every cell on the board to the set
+ */
+void cell_set_fill(CellSet* set) {
+  set->count = set->width * set->height;
+  for (int i = 0; i < set->count; i++) {
+    set->cells[i] = i;
+    set->position_of[i] = i;
+  }
+}
+
+/**
+ * Removes every member, in time proportional to their number
+ */
+void cell_set_clear(CellSet* set) {
+  for (int i = 0; i < set->count; i++) {
+    set->position_of[set->cells[i]] = -1;
+  }
+  set->count = 0;
+}
+
+struct point cell_set_at(CellSet* set, int i) {
+  struct point point = {set->cells[i] % set->width, set->cells[i] / set->width};
+  return point;
+}
+
+void cell_set_free(CellSet* set) {
+  free(set->cells);
+  free(set->position_of);
+  free(set);
+}
+
+/* Missile pool */
+/* Every missile moves up one row per update, so the update is a single pass
+ * that decrements y and compacts out missiles that left the top of the screen.
+ */
+MissilePool* missile_pool_init(int capacity) {
+  MissilePool* pool = malloc(sizeof(struct missile_pool));
+  pool->x = malloc(sizeof(int) * capacity);
+  pool->y = malloc(sizeof(int) * capacity);
+  pool->count = 0;
+  pool->capacity = capacity;
+  return pool;
+}
+
+/**
+ * Returns false if the pool is full
+ */
+bool missile_pool_add(MissilePool* pool, int x, int y) {
+  if (pool->count == pool->capacity) {
+    return false;
+  }
+  pool->x[pool->count] = x;
+  pool->y[pool->count] = y;
+  pool->count++;
+  return true;
+}
+
+void missile_pool_free(MissilePool* pool) {
+  free(pool->x);
+  free(pool->y);
+  free(pool);
+}
+
+/* Snake */
+/* The body is allocated once with room for every cell on the board, so moving
+ * and growing never allocate.
+ */
+
+/**
+ * Returns the i-th point of the snake, counting from the back
+ */
+struct point* snake_point(Snake* snake, int i) {
+  return &snake->body[(snake->tail + i) % snake->capacity];
+}
+
+struct point* snake_front(Snake* snake) {
+  return snake_point(snake, snake->num_points - 1);
+}
+
+struct point* snake_back(Snake* snake) {
+  return snake_point(snake, 0);
+}
+
+/**
+ * Returns the occupancy count for a cell, or NULL if it is off the board
+ */
+unsigned short* _snake_occupancy_at(Snake* snake, int x, int y) {
+  if (x < 0 || x >= snake->width || y < 0 || y >= snake->height) {
+    return NULL;
+  }
+  return &snake->occupancy[y * snake->width + x];
+}
+
+void _snake_occupy(Snake* snake, struct point* point) {
+  unsigned short* count = _snake_occupancy_at(snake, point->x, point->y);
+  if (count != NULL) {
+    (*count)++;
+  }
+}
+
+void _snake_vacate(Snake* snake, struct point* point) {
+  unsigned short* count = _snake_occupancy_at(snake, point->x, point->y);
+  if (count != NULL) {
+    (*count)--;
+  }
+}
+
+void _snake_add_initial_points(Snake* snake) {
+  // Set initial direction
+  snake->direction.dx = 0;
+  snake->direction.dy = 1;
+
+  // Add initial points, from (8,0) at the back to (8,6) at the front
+  memset(snake->occupancy, 0, sizeof(unsigned short) * snake->capacity);
+  snake->tail = 0;
+  snake->num_points = 7;
+  for (int i = 0; i < snake->num_points; i++) {
+    snake->body[i].x = 8;
+    snake->body[i].y = i;
+    _snake_occupy(snake, &snake->body[i]);
+  }
+}
+
+Snake* snake_init(int width, int height) {
+  Snake* mySnake = malloc(sizeof(struct snake));
+  mySnake->width = width;
+  mySnake->height = height;
+  mySnake->capacity = width * height;
+  mySnake->body = malloc(sizeof(struct point) * mySnake->capacity);
+  mySnake->occupancy = malloc(sizeof(unsigned short) * mySnake->capacity);
+
+  _snake_add_initial_points(mySnake);
+
+  mySnake->berriesEaten = 0;
+  mySnake->has_moved = true;
+
+  return mySnake;
+}
+
+void snake_reset(Snake* snake) {
+  _snake_add_initial_points(snake);
+  snake->berriesEaten = 0;
+  snake->has_moved = true;
+}
+
+void snake_print_points(Snake* snake) {
+  log_debug("Direction: %d, %d", snake->direction.dx, snake->direction.dy);
+  for (int i = 0; i < snake->num_points; i++) {
+    struct point* point = snake_point(snake, i);
+    log_debug("Point: %d, %d", point->x, point->y);
+  }
+}
+
+bool snake_change_direction(Snake* snake, int dx, int dy) {
+  // Prevent multiple keypresses before snake has actually moved
+  if (!snake->has_moved) {
+     return false;
+  }
+
+  // No direction change. This check also prevents snake from turning back on itself.
+  if (snake->direction.dx == dx || snake->direction.dy == dy)
+    return false;
+
+  snake->direction.dx = dx;
+  snake->direction.dy = dy;
+  snake->has_moved = false;
+  log_debug("Snake will change direction: %d, %d", dx, dy);
+  return true;
+}
+
+void snake_grow(Snake* snake) {
+  // Snake already covers the whole board
+  if (snake->num_points == snake->capacity) {
+    return;
+  }
+  // Figure out direction of tail based on last two points
+  struct point* old_tail = snake_back(snake);
+  int dx = old_tail->x - snake_point(snake, 1)->x;
+  int dy = old_tail->y - snake_point(snake, 1)->y;
+  snake->tail = (snake->tail + snake->capacity - 1) % snake->capacity;
+  snake->num_points++;
+  struct point* new_tail = snake_back(snake);
+  new_tail->x = old_tail->x + dx;
+  new_tail->y = old_tail->y + dy;
+  _snake_occupy(snake, new_tail);
+}
+
+bool snake_try_eat_berry(Snake* snake, Game* game) {
+  int y = snake_front(snake)->y;
+  int x = snake_front(snake)->x;
+  Berry* berry = game_berry_at(game, x, y);
+  if (berry != NULL) {
+    if (berry->hyper) {
+      game_enter_hyper_mode(game);
+    }
+    game_remove_berry(game, x, y);
+    snake_grow(snake);
+    game_update_free_cell(game, snake_back(snake)->x, snake_back(snake)->y);
+    snake->berriesEaten++;
+    return true;
+  }
+
+  return false;
+}
+
+bool _snake_has_point_at(Snake* snake, int x, int y, bool ignore_front) {
+  unsigned short* count = _snake_occupancy_at(snake, x, y);
+  if (count == NULL) {
+    return false;
+  }
+  struct point* front = snake_front(snake);
+  if (ignore_front && front->x == x && front->y == y) {
+    return *count > 1;
+  }
+  return *count > 0;
+}
+
+bool snake_has_point_at_ignore_front(Snake* snake, int x, int y) {
+  return _snake_has_point_at(snake, x, y, true);
+}
+
+bool snake_has_point_at(Snake* snake, int x, int y) {
+  return _snake_has_point_at(snake, x, y, false);
+}
+
+void snake_go(Snake* snake) {
+  // Add new head in direction snake is moving
+  int x = snake_front(snake)->x + snake->direction.dx;
+  int y = snake_front(snake)->y + snake->direction.dy;
+  // Remove tail; the new head takes over the freed slot when the buffer is full
+  _snake_vacate(snake, snake_back(snake));
+  snake->tail = (snake->tail + 1) % snake->capacity;
+  struct point* front = snake_front(snake);
+  front->x = x;
+  front->y = y;
+  _snake_occupy(snake, front);
+  snake->has_moved = true;
+}
+
+bool snake_check_dead(Snake* snake, Game* game) {
+  // Does snake go out of bounds?
+  struct point* front = snake_front(snake);
+  if (front->x < 0 || front->x >= game->width || front->y < 0 || front->y >= game->height) {
+    return true;
+  }
+
+  // In hyper-mode, snake can go out of bounds but otherwise cannot die
+  if (game->hyperMode) {
+    game->missileHit = false;
+    return false;
+  }
+
+  // Does snake collide with itself?
+  if (snake_has_point_at_ignore_front(snake, front->x, front->y)) {
+    return true;
+  }
+
+  // Does snake collide with a missile?
+  // Missiles flag hits as they move, so only the cells the snake itself just
+  // moved onto (the head, or the tail after growing) need checking here.
+  struct point* back = snake_back(snake);
+  if (game->missileHit || game_missile_at(game, front->x, front->y) ||
+      game_missile_at(game, back->x, back->y)) {
+    return true;
+  }
+
+  return false;
+}
+
+void snake_free(Snake* snake) {
+  free(snake->body);
+  free(snake->occupancy);
+  free(snake);
+}
+
+/* Game */
+void _game_end_time_warp(void*);
+void _game_end_hyper_mode(void*);
+
+Game* game_init(int width, int height, uint64_t seed) {
+  Game* game = malloc(sizeof(struct game));
+  rng_seed(&game->rng, seed);
+  game->width = width;
+  game->height = height;
+  game->snake = snake_init(width, height);
+  game->berries = berry_grid_init(width, height);
+  game->missiles = missile_pool_init(width * height);
+  game->missile_exists = calloc(width * height, sizeof(unsigned short));
+  game->free_cells = cell_set_init(width, height);
+  game->changed_cells = cell_set_init(width, height);
+  game->timers = timer_wheel_init();
+  timer_init(&game->warpTimer, _game_end_time_warp, game);
+  timer_init(&game->hyperTimer, _game_end_hyper_mode, game);
+  game_reset(game);
+
+  // Only the first game starts with missiles already in flight
+  game_add_missile(game);
+  game_add_missile(game);
+  game_add_missile(game);
+  return game;
+}
+
+/**
+ * Starts a new game, keeping the board allocations
+ */
+void game_reset(Game* game) {
+  // First, so the changes below aren't listed one by one
+  game_mark_all_changed(game);
+  game->running = true;
+  game->gameOver = false;
+  game->timeWarp = false;
+  game->hyperMode = false;
+  game->frameDelay = SNAKE_DEFAULT_DELAY;
+  game->missileHit = false;
+  game->tick = 0;
+  game->lastSnakeTick = 0;
+  game->lastMissileTick = 0;
+  timer_wheel_reset(game->timers);
+
+  snake_reset(game->snake);
+  berry_grid_reset(game->berries);
+  game_reset_missiles(game);
+  game_reset_free_cells(game);
+  game_add_random_berry(game);
+}
+
+void game_free(Game* game) {
+  snake_free(game->snake);
+  berry_grid_free(game->berries);
+  missile_pool_free(game->missiles);
+  free(game->missile_exists);
+  cell_set_free(game->free_cells);
+  cell_set_free(game->changed_cells);
+  timer_wheel_free(game->timers);
+  free(game);
+}
+
+/* Game methods */
+void game_pause(Game* game) {
+  // The clock stands still while paused, and every game timer with it
+  game->running = !game->running;
+  if (game->running) {
+    timer_wheel_resume(game->timers);
+  } else {
+    timer_wheel_pause(game->timers);
+  }
+}
+
+void game_handle_input(Game* game, GameInput input) {
+  switch (input) {
+    case GAME_INPUT_DOWN:
+      snake_change_direction(game->snake, 0, 1);
+      break;
+    case GAME_INPUT_UP:
+      snake_change_direction(game->snake, 0, -1);
+      break;
+    case GAME_INPUT_LEFT:
+      snake_change_direction(game->snake, -1, 0);
+      break;
+    case GAME_INPUT_RIGHT:
+      snake_change_direction(game->snake, 1, 0);
+      break;
+    case GAME_INPUT_PAUSE:
+      game_pause(game);
+      break;
+    default:
+      break;
+  }
+}
+
+/**
+ * Applies input, then advances the game by one tick
+ */
+void game_step(Game* game, GameInput input) {
+  game_handle_input(game, input);
+  if (!game->running || game->gameOver) {
+    return;
+  }
+  game->tick++;
+  // Expire temporary modes
+  timer_wheel_advance(game->timers, 1);
+
+  game_next_state(game);
+}
+
+/**
+ * Runs the game forward by up to max_ticks, jumping straight over the ticks
+ * on which nothing happens. Stops after the first tick that changes the game,
+ * so callers can steer or redraw between events. Returns the ticks run, which
+ * is 0 while the game is paused or over.
+ */
+unsigned long game_advance(Game* game, unsigned long max_ticks) {
+  unsigned long due = game_next_event_tick(game);
+  if (due == ULONG_MAX || max_ticks == 0) {
+    return 0;
+  }
+  unsigned long start = game->tick;
+  if (due - start > max_ticks) {
+    timer_wheel_advance(game->timers, max_ticks);
+    game->tick += max_ticks;
+    return max_ticks;
+  }
+  // Nothing is due on the ticks skipped, timers included
+  timer_wheel_advance(game->timers, due - 1 - start);
+  game->tick = due - 1;
+  game_step(game, GAME_INPUT_NONE);
+  return game->tick - start;
+}
+
+int game_score(Game* game) {
+  return 10 * game->snake->berriesEaten;
+}
+
+/**
+ * Random number in [0, bound) from this game's own stream
+ */
+unsigned int game_rand(Game* game, unsigned int bound) {
+  return rng_below(&game->rng, bound);
+}
+
+Berry* game_berry_at(Game* game, int x, int y) {
+  return berry_grid_at(game->berries, x, y);
+}
+
+/**
+ * Re-evaluates whether a cell is free after the snake or a berry changed it
+ */
+void game_update_free_cell(Game* game, int x, int y) {
+  if (x < 0 || x >= game->width || y < 0 || y >= game->height) {
+    return;
+  }
+  game_mark_changed(game, x, y);
+  if (snake_has_point_at(game->snake, x, y) || game_berry_at(game, x, y) != NULL) {
+    cell_set_remove(game->free_cells, x, y);
+  } else {
+    cell_set_add(game->free_cells, x, y);
+  }
+}
+
+/**
+ * Rebuilds the free cell set from scratch, e.g. after a reset
+ */
+void game_reset_free_cells(Game* game) {
+  cell_set_fill(game->free_cells);
+  for (int i = 0; i < game->snake->num_points; i++) {
+    struct point* point = snake_point(game->snake, i);
+    game_update_free_cell(game, point->x, point->y);
+  }
+  for (int i = 0; i < game->berries->count; i++) {
+    Berry* berry = &game->berries->berries[i];
+    game_update_free_cell(game, berry->location.x, berry->location.y);
+  }
+}
+
+void game_add_random_berry(Game* game) {
+  // Pick uniformly among the cells with no snake or berry on them
+  if (game->free_cells->count == 0) {
+    return;
+  }
+  struct point cell = cell_set_at(game->free_cells, game_rand(game, game->free_cells->count));
+  int x = cell.x;
+  int y = cell.y;
+  Berry* berry = berry_grid_add(game->berries, x, y);
+  cell_set_remove(game->free_cells, x, y);
+  game_mark_changed(game, x, y);
+  // Don't add more hyper berries when already in hyper mode
+  if (game->hyperMode == false) {
+    berry->hyper = (game_rand(game, 10) == 1);
+  }
+  // Mark for cleanup if added during hyper
+  berry->added_during_hyper = game->hyperMode;
+  log_debug("Added berry at %d, %d, hyper? %d", x, y, berry->hyper);
+}
+
+void game_cleanup_berries(Game* game) {
+  // Remove berries added during hyper mode.
+  // Walk backwards, since removal moves the last berry into the freed slot.
+  for (int i = game->berries->count - 1; i >= 0; i--) {
+    Berry* berry = &game->berries->berries[i];
+    if (berry->added_during_hyper) {
+      game_remove_berry(game, berry->location.x, berry->location.y);
+    }
+  }
+  // If that is all the berries, add one more.
+  if (game->berries->count == 0) {
+    game_add_random_berry(game);
+  }
+}
+
+void game_remove_berry(Game* game, int x, int y) {
+  if (berry_grid_remove(game->berries, x, y)) {
+    game_update_free_cell(game, x, y);
+  }
+}
+
+/**
+ * Notes that what is on a cell changed, so a renderer only has to look at the
+ * cells listed in changed_cells
+ */
+void game_mark_changed(Game* game, int x, int y) {
+  if (game->all_changed || x < 0 || x >= game->width || y < 0 || y >= game->height) {
+    return;
+  }
+  cell_set_add(game->changed_cells, x, y);
+}
+
+void game_mark_all_changed(Game* game) {
+  game->all_changed = true;
+}
+
+/**
+ * Called once the front end has caught up with the changes
+ */
+void game_clear_changed(Game* game) {
+  cell_set_clear(game->changed_cells);
+  game->all_changed = false;
+}
+
+void _game_mark_snake_changed(Game* game) {
+  for (int i = 0; i < game->snake->num_points; i++) {
+    struct point* point = snake_point(game->snake, i);
+    game_mark_changed(game, point->x, point->y);
+  }
+}
+
+void _game_end_time_warp(void* data) {
+  ((Game*)data)->timeWarp = false;
+}
+
+void _game_end_hyper_mode(void* data) {
+  game_exit_hyper_mode((Game*)data);
+}
+
+void game_set_time_warp(Game* game) {
+  // Temporary speed-up
+  game->timeWarp = true;
+  timer_wheel_schedule(game->timers, &game->warpTimer, GAME_WARP_DURATION);
+}
+
+void game_enter_hyper_mode(Game* game) {
+  log_debug("Entering hyper mode");
+  game->hyperMode = true;
+  // The snake changes colour
+  _game_mark_snake_changed(game);
+  int berries_to_add = 10;
+  while (berries_to_add > 0) {
+    game_add_random_berry(game);
+    berries_to_add--;
+  }
+
+  // Temporary speed-up
+  timer_wheel_schedule(game->timers, &game->hyperTimer, GAME_HYPER_MODE_DURATION);
+}
+
+void game_exit_hyper_mode(Game* game) {
+  log_debug("Disabling hypermode");
+  game->hyperMode = false;
+  _game_mark_snake_changed(game);
+  game_cleanup_berries(game);
+  // Hits were ignored during hyper mode; catch missiles still on the snake
+  for (int i = 0; i < game->missiles->count; i++) {
+    game_check_missile_hit(game, game->missiles->x[i], game->missiles->y[i]);
+  }
+}
+
+bool game_missile_at(Game* game, int x, int y) {
+  if (x < 0 || x >= game->width || y < 0 || y >= game->height) {
+    return false;
+  }
+  return game->missile_exists[y * game->width + x] > 0;
+}
+
+/**
+ * Flags a hit if a missile at x,y sits on the snake
+ */
+void game_check_missile_hit(Game* game, int x, int y) {
+  if (snake_has_point_at(game->snake, x, y)) {
+    game->missileHit = true;
+  }
+}
+
+/**
+ * Launches a missile from a random column on the bottom row
+ */
+void game_add_missile(Game* game) {
+  int x = game_rand(game, game->width);
+  int y = game->height - 1;
+  if (missile_pool_add(game->missiles, x, y)) {
+    game->missile_exists[y * game->width + x]++;
+    game_mark_changed(game, x, y);
+    game_check_missile_hit(game, x, y);
+  }
+}
+
+void game_update_missile_stuff(Game* game) {
+  // Update all missile locations (and missile_exists grid)
+  MissilePool* missiles = game->missiles;
+  int* x = missiles->x;
+  int* y = missiles->y;
+  int width = game->width;
+  int live = 0;
+  for (int i = 0; i < missiles->count; i++) {
+    game->missile_exists[y[i] * width + x[i]]--;
+    game_mark_changed(game, x[i], y[i]);
+    // Missiles on the top row leave the screen
+    if (y[i] > 0) {
+      x[live] = x[i];
+      y[live] = y[i] - 1;
+      game->missile_exists[y[live] * width + x[live]]++;
+      game_mark_changed(game, x[live], y[live]);
+      live++;
+    }
+  }
+  missiles->count = live;
+
+  for (int i = 0; i < missiles->count; i++) {
+    game_check_missile_hit(game, x[i], y[i]);
+  }
+}
+
+/**
+ * Removes all missiles
+ */
+void game_reset_missiles(Game* game) {
+  MissilePool* missiles = game->missiles;
+  for (int i = 0; i < missiles->count; i++) {
+    game->missile_exists[missiles->y[i] * game->width + missiles->x[i]]--;
+    game_mark_changed(game, missiles->x[i], missiles->y[i]);
+  }
+  missiles->count = 0;
+}
+
+/**
+ * Ticks between snake moves right now; the fastest of the delays that apply
+ */
+unsigned long game_snake_delay(Game* game) {
+  unsigned long delay = game->frameDelay;
+  if (game->timeWarp && SNAKE_WARPED_DELAY < delay) {
+    delay = SNAKE_WARPED_DELAY;
+  }
+  if (game->hyperMode && SNAKE_HYPER_DELAY < delay) {
+    delay = SNAKE_HYPER_DELAY;
+  }
+  return delay;
+}
+
+bool game_snake_time_ready(Game* game) {
+    if (game->tick - game->lastSnakeTick >= game_snake_delay(game)) {
+      game->lastSnakeTick = game->tick;
+      return true;
+    }
+    return false;
+}
+
+bool game_missile_time_ready(Game* game) {
+    bool res = game->tick - game->lastMissileTick >= MISSILE_DELAY;
+    if (res) {
+      game->lastMissileTick = game->tick;
+    }
+    return res;
+}
+
+/**
+ * The first tick at which stepping the game will change it: the next snake
+ * move, missile update or end of a temporary mode. Every step before that
+ * only advances the clock. ULONG_MAX if the game is paused or over.
+ */
+unsigned long game_next_event_tick(Game* game) {
+  if (!game->running || game->gameOver) {
+    return ULONG_MAX;
+  }
+  unsigned long next = game->lastSnakeTick + game_snake_delay(game);
+  if (game->lastMissileTick + MISSILE_DELAY < next) {
+    next = game->lastMissileTick + MISSILE_DELAY;
+  }
+  // The game clock and its timer wheel tick together
+  unsigned long timer = timer_wheel_next_due(game->timers);
+  if (timer < next) {
+    next = timer;
+  }
+  return next;
+}
+
+void game_next_state(Game* game) {
+  if (game->running && !game->gameOver) {
+
+    if (game_snake_time_ready(game)) {
+      struct point old_tail = *snake_back(game->snake);
+      snake_go(game->snake);
+      struct point* front = snake_front(game->snake);
+      game_update_free_cell(game, old_tail.x, old_tail.y);
+      game_update_free_cell(game, front->x, front->y);
+    }
+
+    if (game_missile_time_ready(game)) {
+      game_update_missile_stuff(game);
+
+      // Random chance of adding a new missile
+      if (game_rand(game, 200) < 10) {
+        game_add_missile(game);
+      }
+    }
+
+    if (snake_check_dead(game->snake, game)) {
+      game->gameOver = true;
+      return;
+    }
+    if (snake_try_eat_berry(game->snake, game)) {
+      log_debug("Ate berry");
+      
+      game_add_random_berry(game);
+      // Set time warp for next 1 second
+      game_set_time_warp(game);
+      // Decrease delay by 1ms for every 4 berries eaten
+      game->frameDelay = SNAKE_DEFAULT_DELAY - (game->snake->berriesEaten / 4);
+      // Growing puts the tail back on the cell it just left, which a
+      // missile may have moved onto
+      if (snake_check_dead(game->snake, game)) {
+        game->gameOver = true;
+      }
+    }
+  }
+}
@@ -0,0 +1,198 @@
+#ifndef GAME_H
+#define GAME_H
+
+/* Game simulation core */
+/* Everything needed to run a game, with no SDL dependency. The game advances
+ * by logical ticks (one tick is one millisecond of game time), so it can be
+ * driven by a real-time clock in the SDL front end or as fast as possible in
+ * headless simulations.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "rng.h"
+#include "timer-wheel.h"
+#include "log.h"
+
+/* Delays and durations, in ticks */
+#define SNAKE_DEFAULT_DELAY 80
+#define SNAKE_WARPED_DELAY 30
+#define SNAKE_HYPER_DELAY 30
+#define MISSILE_DELAY 80
+#define GAME_WARP_DURATION 600
+#define GAME_HYPER_MODE_DURATION 10000
+
+struct point {
+  int x;
+  int y;
+};
+
+struct direction {
+  int dx;
+  int dy;
+};
+
+typedef struct berry {
+  struct point location;
+  bool hyper;
+  bool added_during_hyper;
+} Berry;
+
+/* Berry grid */
+/* A compact list of berries plus a per-cell index into that list */
+typedef struct berry_grid {
+  int width;
+  int height;
+  int* index_at; // width * height entries, -1 where there is no berry
+  Berry* berries;
+  int count;
+} BerryGrid;
+
+/* Cell set */
+/* A set of board cells supporting O(1) add, remove and uniform random pick */
+typedef struct cell_set {
+  int width;
+  int height;
+  int* cells; // y * width + x for each member
+  int* position_of; // width * height entries, -1 for non-members
+  int count;
+} CellSet;
+
+/* Missile pool */
+/* Missiles are stored as parallel coordinate arrays, allocated once */
+typedef struct missile_pool {
+  int* x;
+  int* y;
+  int count;
+  int capacity;
+} MissilePool;
+
+/* Snake */
+/* Represent the snake as a ring buffer of points.
+ * Index 0 (relative to tail) is the back of the snake, num_points - 1 is the front.
+ */
+typedef struct snake {
+  struct point* body;
+  int capacity;
+  int tail;
+  int num_points;
+  // Number of snake points on each board cell, so lookups don't scan the body.
+  // A count rather than a flag since the snake can overlap itself in hyper mode.
+  int width;
+  int height;
+  unsigned short* occupancy;
+  struct direction direction;
+  bool has_moved;
+  unsigned berriesEaten;
+} Snake;
+
+/* Game */
+typedef struct game {
+  bool running;
+  bool gameOver;
+  int width;
+  int height;
+  struct snake* snake;
+  struct berry_grid* berries;
+  bool timeWarp;
+  bool hyperMode;
+  int frameDelay;
+  // Missiles
+  struct missile_pool* missiles;
+  // Number of missiles on each cell, maintained as missiles move
+  unsigned short* missile_exists;
+  // Set when a missile moves onto the snake
+  bool missileHit;
+  // Cells with neither snake nor berry, where new berries may go
+  struct cell_set* free_cells;
+  // Cells whose contents changed since the front end last drew them, or
+  // all_changed if that is too many to list (a reset)
+  struct cell_set* changed_cells;
+  bool all_changed;
+  // Logical clock
+  unsigned long tick;
+  unsigned long lastSnakeTick;
+  unsigned long lastMissileTick;
+  // Timers on the game clock; they end the temporary modes
+  struct timer_wheel* timers;
+  Timer warpTimer;
+  Timer hyperTimer;
+  // Random number generator, seeded by game_init
+  Rng rng;
+} Game;
+
+typedef enum {
+  GAME_INPUT_NONE,
+  GAME_INPUT_UP,
+  GAME_INPUT_DOWN,
+  GAME_INPUT_LEFT,
+  GAME_INPUT_RIGHT,
+  GAME_INPUT_PAUSE
+} GameInput;
+
+BerryGrid* berry_grid_init(int width, int height);
+Berry* berry_grid_at(BerryGrid*, int x, int y);
+Berry* berry_grid_add(BerryGrid*, int x, int y);
+bool berry_grid_remove(BerryGrid*, int x, int y);
+void berry_grid_reset(BerryGrid*);
+void berry_grid_free(BerryGrid*);
+
+CellSet* cell_set_init(int width, int height);
+void cell_set_add(CellSet*, int x, int y);
+void cell_set_remove(CellSet*, int x, int y);
+void cell_set_fill(CellSet*);
+void cell_set_clear(CellSet*);
+struct point cell_set_at(CellSet*, int i);
+void cell_set_free(CellSet*);
+
+MissilePool* missile_pool_init(int capacity);
+bool missile_pool_add(MissilePool*, int x, int y);
+void missile_pool_free(MissilePool*);
+
+Snake* snake_init(int width, int height);
+void snake_reset(Snake*);
+void snake_free(Snake*);
+struct point* snake_point(Snake*, int i);
+struct point* snake_front(Snake*);
+struct point* snake_back(Snake*);
+void snake_print_points(Snake*);
+bool snake_change_direction(Snake*, int dx, int dy);
+void snake_grow(Snake*);
+void snake_go(Snake*);
+bool snake_has_point_at(Snake*, int x, int y);
+bool snake_has_point_at_ignore_front(Snake*, int x, int y);
+bool snake_try_eat_berry(Snake*, Game*);
+bool snake_check_dead(Snake*, Game*);
+
+Game* game_init(int width, int height, uint64_t seed);
+void game_reset(Game*);
+void game_free(Game*);
+void game_pause(Game*);
+void game_handle_input(Game*, GameInput);
+void game_step(Game*, GameInput);
+unsigned long game_next_event_tick(Game*);
+unsigned long game_advance(Game*, unsigned long max_ticks);
+void game_next_state(Game*);
+Berry* game_berry_at(Game*, int x, int y);
+void game_add_random_berry(Game*);
+void game_remove_berry(Game*, int x, int y);
+void game_cleanup_berries(Game*);
+void game_update_free_cell(Game*, int x, int y);
+void game_reset_free_cells(Game*);
+void game_mark_changed(Game*, int x, int y);
+void game_mark_all_changed(Game*);
+void game_clear_changed(Game*);
+void game_set_time_warp(Game*);
+void game_enter_hyper_mode(Game*);
+void game_exit_hyper_mode(Game*);
+bool game_missile_at(Game*, int x, int y);
+void game_check_missile_hit(Game*, int x, int y);
+void game_add_missile(Game*);
+void game_update_missile_stuff(Game*);
+void game_reset_missiles(Game*);
+int game_score(Game*);
+unsigned int game_rand(Game*, unsigned int bound);
+
+#endif
@@ -0,0 +1,193 @@
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "hash.h"
+
+struct hash* hash_init() {
+  struct hash* hash = malloc(sizeof(struct hash));
+  hash->capacity = HASH_INITIAL_CAPACITY;
+  hash->size = 0;
+  hash->slots = calloc(hash->capacity, sizeof(struct hashslot));
+  hash->keys_capacity = HASH_INITIAL_KEYS_CAPACITY;
+  hash->keys = malloc(hash->keys_capacity);
+  hash->keys_len = 1;
+  hash->keys_dead = 0;
+  return hash;
+};
+
+unsigned long _hash_func(const char* s) {
+  /* djb2 hash function */
+  unsigned long hash = 5381;
+  int c;
+  
+  while ((c = *s++)) {
+    hash = ((hash << 5) + hash) + c; /* hash * 33 + c */
+  }
+
+  return hash;
+}
+
+/**
+ * Returns the slot holding key, or the empty slot that ends its probe run
+ */
+struct hashslot* _hash_find_slot(struct hash* hash, const char* key, unsigned long key_hash) {
+  int mask = hash->capacity - 1;
+  int i = key_hash & mask;
+  while (hash->slots[i].key != 0) {
+    if (hash->slots[i].hash == key_hash && strcmp(hash->keys + hash->slots[i].key, key) == 0) {
+      break;
+    }
+    i = (i + 1) & mask;
+  }
+  return &hash->slots[i];
+}
+
+void _hash_grow(struct hash* hash) {
+  struct hashslot* old_slots = hash->slots;
+  int old_capacity = hash->capacity;
+  hash->capacity *= 2;
+  hash->slots = calloc(hash->capacity, sizeof(struct hashslot));
+  int mask = hash->capacity - 1;
+  for (int i = 0; i < old_capacity; i++) {
+    if (old_slots[i].key != 0) {
+      int j = old_slots[i].hash & mask;
+      while (hash->slots[j].key != 0) {
+        j = (j + 1) & mask;
+      }
+      hash->slots[j] = old_slots[i];
+    }
+  }
+  free(old_slots);
+}
+
+/**
+ * Slides live keys down over the holes deleted keys left in the arena
+ */
+void _hash_compact_keys(struct hash* hash) {
+  int mask = hash->capacity - 1;
+  size_t keys_len = 1;
+  size_t offset = 1;
+  while (offset < hash->keys_len) {
+    const char* key = hash->keys + offset;
+    size_t key_len = strlen(key) + 1;
+    // Only a live key still has a slot pointing at its offset
+    int i = _hash_func(key) & mask;
+    while (hash->slots[i].key != 0 && hash->slots[i].key != offset) {
+      i = (i + 1) & mask;
+    }
+    if (hash->slots[i].key == offset) {
+      memmove(hash->keys + keys_len, key, key_len);
+      hash->slots[i].key = keys_len;
+      keys_len += key_len;
+    }
+    offset += key_len;
+  }
+  hash->keys_len = keys_len;
+  hash->keys_dead = 0;
+}
+
+/**
+ * Makes room for len more bytes of keys. The arena only grows if compacting
+ * it would leave it more than half full.
+ */
+void _hash_reserve_keys(struct hash* hash, size_t len) {
+  if (hash->keys_len + len <= hash->keys_capacity) {
+    return;
+  }
+  size_t live = hash->keys_len - hash->keys_dead;
+  if (live + len > hash->keys_capacity / 2) {
+    while (live + len > hash->keys_capacity / 2) {
+      hash->keys_capacity *= 2;
+    }
+    hash->keys = realloc(hash->keys, hash->keys_capacity);
+  }
+  if (hash->keys_dead > 0) {
+    _hash_compact_keys(hash);
+  }
+}
+
+void* hash_at(struct hash* hash, const char* key) {
+  return _hash_find_slot(hash, key, _hash_func(key))->data;
+}
+
+/**
+ * Adds key to the hash, or replaces its data if it is already present
+ */
+void hash_add(struct hash* hash, const char* key, void* data) {
+  if ((hash->size + 1) * 4 > hash->capacity * 3) {
+    _hash_grow(hash);
+  }
+  unsigned long key_hash = _hash_func(key);
+  struct hashslot* slot = _hash_find_slot(hash, key, key_hash);
+  if (slot->key == 0) {
+    size_t key_len = strlen(key) + 1;
+    _hash_reserve_keys(hash, key_len);
+    memcpy(hash->keys + hash->keys_len, key, key_len);
+    slot->key = hash->keys_len;
+    slot->hash = key_hash;
+    hash->keys_len += key_len;
+    hash->size++;
+  }
+  slot->data = data;
+}
+
+bool hash_delete(struct hash* hash, const char* key) {
+  struct hashslot* slot = _hash_find_slot(hash, key, _hash_func(key));
+  if (slot->key == 0) {
+    return false; // Not Found
+  }
+  hash->keys_dead += strlen(hash->keys + slot->key) + 1;
+  hash->size--;
+
+  // Shift back any entries of the probe run that can no longer reach their slot
+  int mask = hash->capacity - 1;
+  int hole = slot - hash->slots;
+  int i = (hole + 1) & mask;
+  while (hash->slots[i].key != 0) {
+    int home = hash->slots[i].hash & mask;
+    // Entry may move into the hole unless its home lies cyclically in (hole, i]
+    bool stays = (hole <= i) ? (hole < home && home <= i) : (hole < home || home <= i);
+    if (!stays) {
+      hash->slots[hole] = hash->slots[i];
+      hole = i;
+    }
+    i = (i + 1) & mask;
+  }
+  hash->slots[hole].key = 0;
+  hash->slots[hole].data = NULL;
+  return true;
+}
+
+/**
+ * Iterates over the hash. Start with *index = 0; returns false when done.
+ * The hash must not be modified while iterating, and keys are only valid
+ * until it is.
+ */
+bool hash_next(struct hash* hash, int* index, const char** key, void** data) {
+  while (*index < hash->capacity) {
+    struct hashslot* slot = &hash->slots[(*index)++];
+    if (slot->key != 0) {
+      *key = hash->keys + slot->key;
+      *data = slot->data;
+      return true;
+    }
+  }
+  return false;
+}
+
+void hash_reset(struct hash* hash) {
+  for (int i = 0; i < hash->capacity; i++) {
+    hash->slots[i].key = 0;
+    hash->slots[i].data = NULL;
+  }
+  hash->size = 0;
+  hash->keys_len = 1;
+  hash->keys_dead = 0;
+}
+
+void hash_free(struct hash* hash) {
+  free(hash->slots);
+  free(hash->keys);
+  free(hash);
+}
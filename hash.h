@@ -0,0 +1,42 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Hash table */
+/* Open addressing with linear probing. Slots live in a single array that
+ * doubles when the load factor passes 3/4, and deletion shifts later entries
+ * of the probe run back instead of leaving tombstones.
+ * Keys are copied into an arena the table owns, so callers may pass keys on
+ * the stack. Deleted keys leave holes that are compacted away once the arena
+ * fills, so adding and deleting only allocates when the table grows.
+ */
+#define HASH_INITIAL_CAPACITY 16
+#define HASH_INITIAL_KEYS_CAPACITY 256
+
+struct hashslot {
+  size_t key; // Offset of the key in the arena, 0 if the slot is empty
+  unsigned long hash;
+  void* data;
+};
+
+struct hash {
+  int capacity; // Always a power of two
+  int size;
+  struct hashslot* slots;
+  char* keys; // Arena of NUL-terminated keys; offset 0 is never used
+  size_t keys_len;
+  size_t keys_capacity;
+  size_t keys_dead; // Bytes held by deleted keys
+};
+
+struct hash* hash_init();
+void* hash_at(struct hash*, const char* key);
+void hash_add(struct hash*, const char* key, void* data);
+bool hash_delete(struct hash*, const char* key);
+bool hash_next(struct hash*, int* index, const char** key, void** data);
+void hash_reset(struct hash*);
+void hash_free(struct hash*);
+
+#endif
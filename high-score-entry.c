@@ -1,12 +1,13 @@
 
 #include "high-score-entry.h"
+#include "font-cache.h"
+#include "text-atlas.h"
+#include "log.h"
 #include <SDL/SDL.h>
 #include <SDL/SDL_ttf.h>
 #include <SDL/SDL_gfxPrimitives.h>
 #include <stdio.h>
 
-#define FONT_PATH "/usr/share/fonts/truetype/ttf-dejavu/DejaVuSansMono.ttf"
-
 void _high_score_entry_finished_callback(high_score_entry*, void*);
 
 void _high_score_entry_draw_border(high_score_entry* entry, SDL_Surface* screen) {
@@ -43,7 +44,7 @@ void high_score_entry_reset(high_score_entry* entry) {
 }
 
 void _high_score_entry_finished_callback(high_score_entry* entry, void* data) {
-  printf("No high score callback implemented!\n");
+  log_warn("No high score callback implemented!");
 }
 
 void high_score_entry_draw(high_score_entry* entry, SDL_Surface* screen) {
@@ -51,30 +52,22 @@ void high_score_entry_draw(high_score_entry* entry, SDL_Surface* screen) {
   // Draw a gold border
   _high_score_entry_draw_border(entry, screen);
 
-  TTF_Font* font = TTF_OpenFont(FONT_PATH, 50);
-  SDL_Color fg = {255, 255, 255};
+  SDL_Color white = {255, 255, 255};
+  SDL_Color green = {0, 255, 0};
   SDL_Color bg = {0, 0, 0};
-  // Just use this render to get the width for centering
-  SDL_Surface* textSurface = TTF_RenderText_Shaded(font, entry->name, fg, bg);
+  TextAtlas* fg = text_atlas_get(FONT_PATH, HIGH_SCORE_ENTRY_FONT_SIZE, white, bg);
+  TextAtlas* selected = text_atlas_get(FONT_PATH, HIGH_SCORE_ENTRY_FONT_SIZE, green, bg);
+  if (fg == NULL || selected == NULL) {
+    return;
+  }
 
-  int offset = (screen->w - textSurface->w)/2;
-  int v_center = (screen->h - textSurface->h)/2;
+  int offset = (screen->w - text_atlas_width(fg, entry->name))/2;
+  int v_center = (screen->h - fg->height)/2;
   for (int i = 0; i <= 2; i++) {
-    if (i == entry->index) {
-      fg = (SDL_Color){0, 255, 0};
-    } else {
-      fg = (SDL_Color){255, 255, 255};
-    }
     char str[] = {entry->name[i], 0};
-    SDL_Surface* text = TTF_RenderText_Shaded(font, str, fg, bg);
-    SDL_Rect textLocation = {offset, v_center, 0, 0};
-    SDL_BlitSurface(text, NULL, screen, &textLocation);
-    offset += text->w;
-    SDL_FreeSurface(text);
+    TextAtlas* atlas = (i == entry->index) ? selected : fg;
+    offset += text_atlas_draw(atlas, screen, str, offset, v_center);
   }
-
-  SDL_FreeSurface(textSurface);
-  TTF_CloseFont(font);
 }
 
 void high_score_entry_free(high_score_entry* entry) {
@@ -4,6 +4,8 @@
 
 #include <SDL/SDL.h>
 
+#define HIGH_SCORE_ENTRY_FONT_SIZE 50
+
 typedef struct high_score_entry {
   char name[4];
   int index;
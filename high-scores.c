@@ -0,0 +1,520 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "high-scores.h"
+#include "encoding.h"
+#include "log.h"
+
+/**
+ * $HOME/.snake, worked out on first use. NULL if there is no home directory.
+ */
+const char* high_scores_default_dir() {
+  static char* dir = NULL;
+  if (dir == NULL) {
+    const char* home = getenv("HOME");
+    if (home == NULL || home[0] == '\0') {
+      return NULL;
+    }
+    dir = malloc(strlen(home) + sizeof(HIGH_SCORES_DIR) + 1);
+    sprintf(dir, "%s/%s", home, HIGH_SCORES_DIR);
+  }
+  return dir;
+}
+
+/* Importing old tables */
+
+typedef struct legacy_table {
+  LeaderboardEntry entries[HIGH_SCORES_MAX];
+  int count;
+} LegacyTable;
+
+/**
+ * One to three printable characters, no commas so the text file parses
+ */
+bool _high_scores_valid_name(const char* name, size_t len) {
+  if (len == 0 || len >= LEADERBOARD_NAME_SIZE) {
+    return false;
+  }
+  for (size_t i = 0; i < len; i++) {
+    if (name[i] < ' ' || name[i] > '~' || name[i] == ',') {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool _high_scores_add_legacy(LegacyTable* table, const char* name, size_t name_len, long points) {
+  if (table->count == HIGH_SCORES_MAX || !_high_scores_valid_name(name, name_len) ||
+      points < 0 || points > INT32_MAX) {
+    return false;
+  }
+  // Best first, as we always wrote them
+  if (table->count > 0 && points > table->entries[table->count - 1].points) {
+    return false;
+  }
+  LeaderboardEntry* entry = &table->entries[table->count++];
+  memset(entry->name, 0, LEADERBOARD_NAME_SIZE);
+  memcpy(entry->name, name, name_len);
+  entry->points = points;
+  return true;
+}
+
+/**
+ * Reads all of a small file. Returns its length, or -1 if it is missing,
+ * unreadable or over HIGH_SCORES_MAX_FILE_SIZE.
+ */
+long _high_scores_read_file(const char* dir, const char* name, unsigned char* data) {
+  char path[4096];
+  snprintf(path, sizeof(path), "%s/%s", dir, name);
+  FILE* file = fopen(path, "rb");
+  if (file == NULL) {
+    return -1;
+  }
+  size_t len = fread(data, 1, HIGH_SCORES_MAX_FILE_SIZE + 1, file);
+  bool failed = ferror(file);
+  fclose(file);
+  if (failed || len > HIGH_SCORES_MAX_FILE_SIZE) {
+    log_warn("Ignoring %s/%s: unreadable or too big", dir, name);
+    return -1;
+  }
+  return len;
+}
+
+bool _high_scores_parse_binary(LegacyTable* table, const unsigned char* data, size_t len) {
+  if (len < HIGH_SCORES_HEADER_SIZE || memcmp(data, HIGH_SCORES_MAGIC, 4) != 0 ||
+      data[4] != HIGH_SCORES_VERSION) {
+    return false;
+  }
+  int count = data[5];
+  if (count > HIGH_SCORES_MAX || len != HIGH_SCORES_HEADER_SIZE + count * HIGH_SCORES_RECORD_SIZE) {
+    return false;
+  }
+  const unsigned char* records = data + HIGH_SCORES_HEADER_SIZE;
+  if (encoding_get_u32(data + 8) != encoding_checksum(records, len - HIGH_SCORES_HEADER_SIZE)) {
+    return false;
+  }
+  for (int i = 0; i < count; i++) {
+    const unsigned char* record = records + i * HIGH_SCORES_RECORD_SIZE;
+    const char* name = (const char*)record;
+    if (!_high_scores_add_legacy(table, name, strnlen(name, LEADERBOARD_NAME_SIZE),
+                                 encoding_get_u32(record + 4))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool _high_scores_parse_text(LegacyTable* table, char* data, size_t len) {
+  data[len] = '\0';
+  if (strlen(data) != len) {
+    return false;
+  }
+  char* line = data;
+  while (*line != '\0') {
+    char* end = strchr(line, '\n');
+    if (end == NULL) {
+      // Every line we write is terminated
+      return false;
+    }
+    *end = '\0';
+    if (line == end) {
+      // Blank line ends the table
+      return true;
+    }
+    char* comma = strchr(line, ',');
+    if (comma == NULL || comma[1] == '\0') {
+      return false;
+    }
+    char* digits_end;
+    errno = 0;
+    long points = strtol(comma + 1, &digits_end, 10);
+    if (errno != 0 || *digits_end != '\0' ||
+        !_high_scores_add_legacy(table, line, comma - line, points)) {
+      return false;
+    }
+    line = end + 1;
+  }
+  return true;
+}
+
+/**
+ * Reads the table an older build left in dir, if any
+ */
+void _high_scores_read_legacy(LegacyTable* table, const char* dir) {
+  unsigned char data[HIGH_SCORES_MAX_FILE_SIZE + 2];
+  table->count = 0;
+  long len = _high_scores_read_file(dir, HIGH_SCORES_BINARY_FILE, data);
+  if (len >= 0) {
+    if (_high_scores_parse_binary(table, data, len)) {
+      return;
+    }
+    log_warn("Ignoring %s/%s: not a valid high score table", dir, HIGH_SCORES_BINARY_FILE);
+    table->count = 0;
+  }
+  len = _high_scores_read_file(dir, HIGH_SCORES_TEXT_FILE, data);
+  if (len >= 0 && !_high_scores_parse_text(table, (char*)data, len)) {
+    log_warn("Ignoring %s/%s: not a valid high score table", dir, HIGH_SCORES_TEXT_FILE);
+    table->count = 0;
+  }
+}
+
+/* Board file and delta log */
+
+/**
+ * Reads the whole log into memory, or as much of it as shows that it is
+ * over HIGH_SCORES_MAX_LOG_SIZE. Returns NULL if there isn't one.
+ */
+unsigned char* _high_scores_read_log(const char* path, size_t* len) {
+  FILE* file = fopen(path, "rb");
+  if (file == NULL) {
+    return NULL;
+  }
+  struct stat info;
+  unsigned char* data = NULL;
+  if (fstat(fileno(file), &info) == 0) {
+    size_t size = (uintmax_t)info.st_size > HIGH_SCORES_MAX_LOG_SIZE ? HIGH_SCORES_MAX_LOG_SIZE + 1
+                                                                     : (size_t)info.st_size;
+    data = malloc(size > 0 ? size : 1);
+    *len = fread(data, 1, size, file);
+  }
+  fclose(file);
+  return data;
+}
+
+/**
+ * Moves a damaged file out of the way, keeping it for inspection
+ */
+void _high_scores_set_aside(const char* path) {
+  char aside[4096];
+  snprintf(aside, sizeof(aside), "%s.bad", path);
+  log_warn("%s is damaged, moving it to %s", path, aside);
+  rename(path, aside);
+}
+
+/**
+ * Merges the delta into a new board file and starts a new log. With a
+ * writer this happens on its thread, and the delta is kept aside until the
+ * merged board comes back. The merged board is used from then on whether or
+ * not it reaches the disk; if it doesn't, the old log still holds its
+ * entries.
+ */
+void _high_scores_merge(high_scores* scores) {
+  if (scores->writer != NULL) {
+    scores->merging = scores->delta;
+    scores->delta = leaderboard_init(HIGH_SCORES_BOARD_SIZE);
+    score_writer_merge(scores->writer, leaderboard_file_retain(scores->board), scores->merging,
+                       HIGH_SCORES_BOARD_SIZE);
+    return;
+  }
+
+  size_t len;
+  unsigned char* image = leaderboard_file_merge(scores->board, scores->delta, HIGH_SCORES_BOARD_SIZE,
+                                                scores->board->generation + 1, &len);
+  LeaderboardFile* board = leaderboard_file_from_image(image, len);
+  if (scores->board_path != NULL &&
+      score_writer_save_board(scores->board_path, scores->log_path, board)) {
+    scores->saved_generation = board->generation;
+  }
+  leaderboard_file_close(scores->board);
+  scores->board = board;
+  leaderboard_free(scores->delta);
+  scores->delta = leaderboard_init(HIGH_SCORES_BOARD_SIZE);
+}
+
+/**
+ * Swaps in the board the writer merged, once it is done
+ */
+void _high_scores_collect_merge(high_scores* scores) {
+  if (scores->merging == NULL) {
+    return;
+  }
+  LeaderboardFile* board = score_writer_take_merged(scores->writer);
+  if (board == NULL) {
+    return;
+  }
+  leaderboard_file_close(scores->board);
+  scores->board = board;
+  leaderboard_free(scores->merging);
+  scores->merging = NULL;
+}
+
+/**
+ * Reads the delta log into the delta. Returns false if there is no log to
+ * append to, so a new one has to be written.
+ */
+bool _high_scores_read_delta(high_scores* scores) {
+  size_t len = 0;
+  unsigned char* log = _high_scores_read_log(scores->log_path, &len);
+  if (log == NULL) {
+    return false;
+  }
+  if (len > HIGH_SCORES_MAX_LOG_SIZE) {
+    free(log);
+    _high_scores_set_aside(scores->log_path);
+    return false;
+  }
+  uint32_t generation;
+  size_t intact = leaderboard_load(scores->delta, log, len, &generation);
+  free(log);
+  if (intact == 0) {
+    _high_scores_set_aside(scores->log_path);
+    return false;
+  }
+  if (generation != scores->board->generation) {
+    // Merged into the board already, before a crash kept it from being reset
+    leaderboard_free(scores->delta);
+    scores->delta = leaderboard_init(HIGH_SCORES_BOARD_SIZE);
+    return false;
+  }
+  if (intact < len) {
+    log_warn("Cutting the torn end off %s", scores->log_path);
+    if (truncate(scores->log_path, intact) != 0) {
+      log_error("Unable to repair %s: %s", scores->log_path, strerror(errno));
+    }
+  }
+  return true;
+}
+
+/**
+ * Loads the board kept in dir. A missing board starts empty, or from the
+ * table an older build left there. A NULL dir gives an empty board that is
+ * never saved.
+ */
+high_scores* high_scores_load(const char* dir) {
+  high_scores* scores = malloc(sizeof(high_scores));
+  scores->board = NULL;
+  scores->delta = leaderboard_init(HIGH_SCORES_BOARD_SIZE);
+  scores->merging = NULL;
+  scores->current_index = -1;
+  scores->board_path = NULL;
+  scores->log_path = NULL;
+  scores->writer = NULL;
+  scores->client = NULL;
+  if (dir != NULL && mkdir(dir, 0755) != 0 && errno != EEXIST) {
+    log_error("Unable to create %s: %s; high scores won't be saved", dir, strerror(errno));
+    dir = NULL;
+  }
+  if (dir != NULL) {
+    scores->board_path = malloc(strlen(dir) + sizeof(HIGH_SCORES_BOARD_FILE) + 1);
+    sprintf(scores->board_path, "%s/%s", dir, HIGH_SCORES_BOARD_FILE);
+    scores->log_path = malloc(strlen(dir) + sizeof(HIGH_SCORES_LOG_FILE) + 1);
+    sprintf(scores->log_path, "%s/%s", dir, HIGH_SCORES_LOG_FILE);
+    scores->board = leaderboard_file_open(scores->board_path);
+    if (scores->board == NULL && access(scores->board_path, F_OK) == 0) {
+      _high_scores_set_aside(scores->board_path);
+    }
+  }
+  bool have_board_file = scores->board != NULL;
+  if (scores->board == NULL) {
+    size_t len;
+    unsigned char* empty = leaderboard_file_merge(NULL, scores->delta, 0, 0, &len);
+    scores->board = leaderboard_file_from_image(empty, len);
+  }
+  scores->saved_generation = scores->board->generation;
+  if (dir == NULL) {
+    return scores;
+  }
+
+  bool have_log = _high_scores_read_delta(scores);
+  if (!have_board_file && !have_log) {
+    LegacyTable table;
+    _high_scores_read_legacy(&table, dir);
+    // Worst first, so ties keep their order
+    for (int i = table.count - 1; i >= 0; i--) {
+      leaderboard_insert(scores->delta, table.entries[i].name, table.entries[i].points);
+    }
+  }
+  // A log from before board files can be big; fold it in now
+  if (!have_board_file || !have_log || scores->delta->count >= HIGH_SCORES_DELTA_MAX) {
+    _high_scores_merge(scores);
+  }
+  return scores;
+}
+
+/**
+ * Uses the board of the score server listening on socket_path. Returns NULL
+ * if there isn't one.
+ */
+high_scores* high_scores_connect(const char* socket_path) {
+  ScoreClient* client = score_client_connect(socket_path);
+  if (client == NULL) {
+    log_warn("Unable to reach a score server on %s: %s", socket_path, strerror(errno));
+    return NULL;
+  }
+  high_scores* scores = high_scores_load(NULL);
+  scores->client = client;
+  return scores;
+}
+
+/**
+ * Gives up on a server that has stopped answering
+ */
+void _high_scores_disconnect(high_scores* scores) {
+  log_error("Lost the score server; scores from now on won't be saved");
+  score_client_close(scores->client);
+  scores->client = NULL;
+}
+
+/**
+ * Saves from now on happen on a background thread
+ */
+void high_scores_start_writer(high_scores* scores) {
+  if (scores->log_path != NULL && scores->writer == NULL) {
+    scores->writer = score_writer_start(scores->log_path, scores->board_path, scores->saved_generation);
+  }
+}
+
+/**
+ * Reset high scores structure
+ */
+void high_scores_reset(high_scores* scores) {
+  scores->current_index = -1;
+}
+
+/**
+ * The rank a new score of value would get: the number of entries that beat it
+ */
+int high_scores_rank(high_scores* scores, int value) {
+  int rank;
+  if (scores->client != NULL) {
+    if (score_client_ranks(scores->client, &value, 1, &rank, NULL)) {
+      return rank;
+    }
+    _high_scores_disconnect(scores);
+  }
+  _high_scores_collect_merge(scores);
+  rank = leaderboard_file_rank(scores->board, value) + leaderboard_rank(scores->delta, value);
+  if (scores->merging != NULL) {
+    rank += leaderboard_rank(scores->merging, value);
+  }
+  return rank;
+}
+
+int high_scores_count(high_scores* scores) {
+  int rank, count;
+  int value = 0;
+  if (scores->client != NULL) {
+    if (score_client_ranks(scores->client, &value, 1, &rank, &count)) {
+      return count;
+    }
+    _high_scores_disconnect(scores);
+  }
+  _high_scores_collect_merge(scores);
+  count = scores->board->count + scores->delta->count;
+  if (scores->merging != NULL) {
+    count += scores->merging->count;
+  }
+  return count < HIGH_SCORES_BOARD_SIZE ? count : HIGH_SCORES_BOARD_SIZE;
+}
+
+/**
+ * Returns -1 if score is not in top 10, otherwise returns 0-based index of score
+ */
+int high_scores_get_score_index(high_scores* scores, int value) {
+  int rank = high_scores_rank(scores, value);
+  return rank < HIGH_SCORES_MAX ? rank : -1;
+}
+
+/**
+ * Adds a score to the board and saves it. Returns false, changing nothing,
+ * if the name or score is invalid. A failed save is only logged.
+ */
+bool high_scores_add_score(high_scores* scores, int value, const char* name) {
+  if (!_high_scores_valid_name(name, strlen(name)) || value < 0) {
+    return false;
+  }
+  LeaderboardEntry entry;
+  memset(entry.name, 0, LEADERBOARD_NAME_SIZE);
+  strcpy(entry.name, name);
+  entry.points = value;
+  if (scores->client != NULL) {
+    int rank;
+    if (score_client_submit(scores->client, &entry, 1, &rank)) {
+      scores->current_index = rank >= 0 && rank < HIGH_SCORES_MAX ? rank : -1;
+      return true;
+    }
+    _high_scores_disconnect(scores);
+  }
+  scores->current_index = high_scores_get_score_index(scores, value);
+  leaderboard_insert(scores->delta, name, value);
+
+  unsigned char record[LEADERBOARD_RECORD_SIZE];
+  leaderboard_encode_record(&entry, record);
+  if (scores->delta->count >= HIGH_SCORES_DELTA_MAX && scores->merging == NULL) {
+    // The new log starts after this score
+    _high_scores_merge(scores);
+  } else if (scores->writer != NULL) {
+    score_writer_append(scores->writer, record, sizeof(record));
+  } else if (scores->log_path != NULL) {
+    score_writer_save_records(scores->log_path, scores->saved_generation, record, sizeof(record));
+  }
+  return true;
+}
+
+/**
+ * Copies out up to max of the best entries, best first. Returns how many.
+ */
+int high_scores_top(high_scores* scores, LeaderboardEntry* entries, int max) {
+  if (scores->client != NULL) {
+    int count = score_client_top(scores->client, entries, max);
+    if (count >= 0) {
+      return count;
+    }
+    _high_scores_disconnect(scores);
+  }
+  _high_scores_collect_merge(scores);
+  int from_board = 0;
+  int from_delta = 0;
+  int from_merging = 0;
+  int count = 0;
+  LeaderboardEntry board_entry;
+  while (count < max && count < HIGH_SCORES_BOARD_SIZE) {
+    // Newer entries win ties: the delta, then the one being merged, then the board
+    const LeaderboardEntry* best = leaderboard_at(scores->delta, from_delta);
+    int* from = &from_delta;
+    if (scores->merging != NULL) {
+      const LeaderboardEntry* merging_entry = leaderboard_at(scores->merging, from_merging);
+      if (merging_entry != NULL && (best == NULL || merging_entry->points > best->points)) {
+        best = merging_entry;
+        from = &from_merging;
+      }
+    }
+    if (from_board < scores->board->count) {
+      leaderboard_file_at(scores->board, from_board, &board_entry);
+      if (best == NULL || board_entry.points > best->points) {
+        best = &board_entry;
+        from = &from_board;
+      }
+    }
+    if (best == NULL) {
+      break;
+    }
+    entries[count++] = *best;
+    (*from)++;
+  }
+  return count;
+}
+
+/**
+ * Frees the table, first waiting for the writer to save everything queued
+ */
+void high_scores_free(high_scores* scores) {
+  if (scores->writer != NULL) {
+    score_writer_stop(scores->writer);
+  }
+  if (scores->client != NULL) {
+    score_client_close(scores->client);
+  }
+  leaderboard_file_close(scores->board);
+  leaderboard_free(scores->delta);
+  if (scores->merging != NULL) {
+    leaderboard_free(scores->merging);
+  }
+  free(scores->board_path);
+  free(scores->log_path);
+  free(scores);
+}
@@ -0,0 +1,86 @@
+#ifndef HIGH_SCORES_H
+#define HIGH_SCORES_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "leaderboard.h"
+#include "leaderboard-file.h"
+#include "score-writer.h"
+#include "score-client.h"
+
+/* High scores */
+/* The top ten table is a view of a leaderboard kept in ~/.snake in two
+ * parts. scores.db is a ranked board file (see leaderboard-file.h), mapped
+ * at startup and queried in place. scores.log is a write-ahead delta of the
+ * scores entered since, in the log format of leaderboard.h, read into a
+ * small in-memory board. Ranks and the top ten come from both at once.
+ * Adding a score inserts it into the delta and appends it to the log, on
+ * the score writer thread once one is started. When the delta reaches
+ * HIGH_SCORES_DELTA_MAX entries it is merged into a new scores.db, one
+ * generation on, and the log starts again with that generation. With a
+ * writer the merge is built and saved on its thread: the full delta is set
+ * aside and still queried until the merged board comes back, while new
+ * scores go to a fresh delta. A log whose generation doesn't match
+ * scores.db has already been merged and is ignored, and a log with a torn
+ * end is cut back to its last intact record. A log longer than
+ * HIGH_SCORES_MAX_LOG_SIZE can't be one we wrote and is set aside.
+ *
+ * Older builds kept just the table, which is imported into a new log the
+ * first time:
+ *   scores.bin: "SNKS", a version byte, the count, two zero bytes, then an
+ *     FNV-1a checksum of the records as 4 little-endian bytes, followed by
+ *     one 8 byte record per score: the name, NUL padded to 4 bytes, and the
+ *     points as 4 little-endian bytes. Best score first.
+ *   scores.txt: one "name,points" line per score.
+ * A file that is too big, malformed or fails its checksum is ignored.
+ *
+ * Connected to a score server instead, the board is the server's: adding,
+ * ranking and listing scores are requests to it. If the server stops
+ * answering, the table carries on with an empty board kept in memory.
+ */
+#define HIGH_SCORES_MAX 10
+// Entries kept on the board; the worst drops off past this
+#define HIGH_SCORES_BOARD_SIZE 1000000
+#define HIGH_SCORES_DIR ".snake" // In $HOME
+// Scores kept in the delta before they are merged into the board file
+#define HIGH_SCORES_DELTA_MAX 4096
+// Logs from before board files were compacted once they held twice the board
+#define HIGH_SCORES_MAX_LOG_SIZE \
+  (LEADERBOARD_HEADER_SIZE + 2 * (size_t)HIGH_SCORES_BOARD_SIZE * LEADERBOARD_RECORD_SIZE)
+#define HIGH_SCORES_BOARD_FILE "scores.db"
+#define HIGH_SCORES_LOG_FILE "scores.log"
+#define HIGH_SCORES_BINARY_FILE "scores.bin"
+#define HIGH_SCORES_TEXT_FILE "scores.txt"
+#define HIGH_SCORES_MAGIC "SNKS"
+#define HIGH_SCORES_VERSION 1
+#define HIGH_SCORES_HEADER_SIZE 12
+#define HIGH_SCORES_RECORD_SIZE 8
+// Anything bigger can't be a table we wrote
+#define HIGH_SCORES_MAX_FILE_SIZE 4096
+
+typedef struct high_scores {
+  LeaderboardFile* board; // Mapped, or held in memory since the last merge
+  Leaderboard* delta;
+  Leaderboard* merging; // Full delta the writer is merging into the board, or NULL
+  int current_index; // Rank of the score just added, or -1
+  char* board_path; // NULL to keep everything in memory only
+  char* log_path;
+  uint32_t saved_generation; // Of the board file on disk, which the log has to match
+  ScoreWriter* writer; // NULL writes on the calling thread
+  ScoreClient* client; // Set when the board is a score server's
+} high_scores;
+
+const char* high_scores_default_dir();
+high_scores* high_scores_load(const char* dir);
+high_scores* high_scores_connect(const char* socket_path);
+void high_scores_start_writer(high_scores*);
+void high_scores_reset(high_scores*);
+int high_scores_rank(high_scores*, int value);
+int high_scores_count(high_scores*);
+int high_scores_get_score_index(high_scores*, int value);
+bool high_scores_add_score(high_scores*, int value, const char* name);
+int high_scores_top(high_scores*, LeaderboardEntry* entries, int max);
+void high_scores_free(high_scores*);
+
+#endif
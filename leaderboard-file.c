@@ -0,0 +1,185 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "leaderboard-file.h"
+#include "encoding.h"
+
+/**
+ * Checks the header against the length of the whole file, and the records
+ * against their checksum and rank order
+ */
+bool _leaderboard_file_valid(const unsigned char* data, size_t len) {
+  if (len < LEADERBOARD_FILE_HEADER_SIZE || memcmp(data, LEADERBOARD_FILE_MAGIC, 4) != 0 ||
+      data[4] != LEADERBOARD_FILE_VERSION ||
+      encoding_get_u32(data + 20) != encoding_checksum(data, 20)) {
+    return false;
+  }
+  uint32_t count = encoding_get_u32(data + 12);
+  if (count > INT32_MAX ||
+      len != LEADERBOARD_FILE_HEADER_SIZE + (size_t)count * LEADERBOARD_FILE_RECORD_SIZE) {
+    return false;
+  }
+  const unsigned char* records = data + LEADERBOARD_FILE_HEADER_SIZE;
+  if (encoding_get_u32(data + 16) != encoding_checksum(records, len - LEADERBOARD_FILE_HEADER_SIZE)) {
+    return false;
+  }
+  uint32_t previous = INT32_MAX;
+  for (uint32_t i = 0; i < count; i++) {
+    uint32_t points = encoding_get_u32(records + (size_t)i * LEADERBOARD_FILE_RECORD_SIZE + 4);
+    if (points > previous) {
+      return false;
+    }
+    previous = points;
+  }
+  return true;
+}
+
+LeaderboardFile* _leaderboard_file_init(void* data, size_t len, bool mapped) {
+  LeaderboardFile* file = malloc(sizeof(LeaderboardFile));
+  const unsigned char* header = data;
+  file->records = header + LEADERBOARD_FILE_HEADER_SIZE;
+  file->generation = encoding_get_u32(header + 8);
+  file->count = encoding_get_u32(header + 12);
+  file->data = data;
+  file->len = len;
+  file->mapped = mapped;
+  file->refs = 1;
+  return file;
+}
+
+/**
+ * Maps the board at path. Returns NULL if it is missing or isn't a valid
+ * board file.
+ */
+LeaderboardFile* leaderboard_file_open(const char* path) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return NULL;
+  }
+  struct stat info;
+  void* data = MAP_FAILED;
+  if (fstat(fd, &info) == 0 && info.st_size >= LEADERBOARD_FILE_HEADER_SIZE) {
+    data = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  }
+  close(fd);
+  if (data == MAP_FAILED) {
+    return NULL;
+  }
+  if (!_leaderboard_file_valid(data, info.st_size)) {
+    munmap(data, info.st_size);
+    return NULL;
+  }
+  return _leaderboard_file_init(data, info.st_size, true);
+}
+
+/**
+ * Wraps a board file image held in memory, taking ownership of it.
+ * Returns NULL, freeing it, if it isn't valid.
+ */
+LeaderboardFile* leaderboard_file_from_image(unsigned char* image, size_t len) {
+  if (!_leaderboard_file_valid(image, len)) {
+    free(image);
+    return NULL;
+  }
+  return _leaderboard_file_init(image, len, false);
+}
+
+int _leaderboard_file_points(LeaderboardFile* file, int rank) {
+  return encoding_get_u32(file->records + (size_t)rank * LEADERBOARD_FILE_RECORD_SIZE + 4);
+}
+
+/**
+ * The number of entries that beat points
+ */
+int leaderboard_file_rank(LeaderboardFile* file, int points) {
+  int low = 0;
+  int high = file->count;
+  while (low < high) {
+    int mid = low + (high - low) / 2;
+    if (_leaderboard_file_points(file, mid) > points) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low;
+}
+
+void leaderboard_file_at(LeaderboardFile* file, int rank, LeaderboardEntry* entry) {
+  const unsigned char* record = file->records + (size_t)rank * LEADERBOARD_FILE_RECORD_SIZE;
+  memcpy(entry->name, record, LEADERBOARD_NAME_SIZE);
+  entry->name[LEADERBOARD_NAME_SIZE - 1] = '\0';
+  entry->points = encoding_get_u32(record + 4);
+}
+
+/**
+ * Builds the image of a new board file holding the file's entries and the
+ * delta's, up to max_entries, malloc'd. Delta entries are newer, so they
+ * rank first among equal scores. A NULL file counts as empty.
+ */
+unsigned char* leaderboard_file_merge(LeaderboardFile* file, Leaderboard* delta, int max_entries,
+                                      uint32_t generation, size_t* len) {
+  LeaderboardEntry* added = malloc(sizeof(LeaderboardEntry) * (delta->count + 1));
+  int num_added = leaderboard_top(delta, added, delta->count);
+  int num_file = file != NULL ? file->count : 0;
+  int count = num_file + num_added;
+  if (count > max_entries) {
+    count = max_entries;
+  }
+
+  *len = LEADERBOARD_FILE_HEADER_SIZE + (size_t)count * LEADERBOARD_FILE_RECORD_SIZE;
+  unsigned char* image = malloc(*len);
+  memset(image, 0, LEADERBOARD_FILE_HEADER_SIZE);
+  memcpy(image, LEADERBOARD_FILE_MAGIC, 4);
+  image[4] = LEADERBOARD_FILE_VERSION;
+  encoding_put_u32(image + 8, generation);
+  encoding_put_u32(image + 12, count);
+
+  unsigned char* out = image + LEADERBOARD_FILE_HEADER_SIZE;
+  int from_file = 0;
+  int from_delta = 0;
+  for (int i = 0; i < count; i++, out += LEADERBOARD_FILE_RECORD_SIZE) {
+    if (from_delta < num_added &&
+        (from_file == num_file || added[from_delta].points >= _leaderboard_file_points(file, from_file))) {
+      memcpy(out, added[from_delta].name, LEADERBOARD_NAME_SIZE);
+      encoding_put_u32(out + 4, added[from_delta].points);
+      from_delta++;
+    } else {
+      // Already in the file's format
+      memcpy(out, file->records + (size_t)from_file * LEADERBOARD_FILE_RECORD_SIZE,
+             LEADERBOARD_FILE_RECORD_SIZE);
+      from_file++;
+    }
+  }
+  free(added);
+  encoding_put_u32(image + 16, encoding_checksum(image + LEADERBOARD_FILE_HEADER_SIZE,
+                                                 *len - LEADERBOARD_FILE_HEADER_SIZE));
+  encoding_put_u32(image + 20, encoding_checksum(image, 20));
+  return image;
+}
+
+/**
+ * Shares the board with another holder, e.g. a writer saving it on another
+ * thread, which closes it when done. Returns the board.
+ */
+LeaderboardFile* leaderboard_file_retain(LeaderboardFile* file) {
+  __atomic_add_fetch(&file->refs, 1, __ATOMIC_RELAXED);
+  return file;
+}
+
+void leaderboard_file_close(LeaderboardFile* file) {
+  if (__atomic_sub_fetch(&file->refs, 1, __ATOMIC_ACQ_REL) > 0) {
+    return;
+  }
+  if (file->mapped) {
+    munmap(file->data, file->len);
+  } else {
+    free(file->data);
+  }
+  free(file);
+}
@@ -0,0 +1,52 @@
+#ifndef LEADERBOARD_FILE_H
+#define LEADERBOARD_FILE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "leaderboard.h"
+
+/* Leaderboard file */
+/* A ranked board on disk, laid out to be mapped read-only and queried in
+ * place: no parsing and no allocation per entry at startup, however many
+ * entries it holds. The file is
+ *   "SNKD", a version byte, three zero bytes, the generation, the count, an
+ *   FNV-1a checksum of the records and one of the preceding 20 bytes, each
+ *   as 4 little-endian bytes,
+ * followed by count fixed 8 byte records, best first:
+ *   the name, NUL padded to 4 bytes, then the points as 4 little-endian
+ *   bytes.
+ * Opening a file checks it in one pass over the records: their checksum,
+ * and that the points never go up or past INT32_MAX, which the binary
+ * searches rely on.
+ * The records being in rank order makes the file its own index: a score is
+ * ranked by binary search and a rank is an offset. New entries go to a
+ * delta log first (see high-scores.h) and are merged in by writing a whole
+ * new file, one generation on, in place of the old one.
+ */
+#define LEADERBOARD_FILE_MAGIC "SNKD"
+#define LEADERBOARD_FILE_VERSION 1
+#define LEADERBOARD_FILE_HEADER_SIZE 24
+#define LEADERBOARD_FILE_RECORD_SIZE 8
+
+typedef struct leaderboard_file {
+  const unsigned char* records;
+  int count;
+  uint32_t generation;
+  void* data; // Mapped or malloc'd, whichever holds the records
+  size_t len;
+  bool mapped;
+  int refs; // Holders; the last to close it frees it
+} LeaderboardFile;
+
+LeaderboardFile* leaderboard_file_open(const char* path);
+LeaderboardFile* leaderboard_file_from_image(unsigned char* image, size_t len);
+int leaderboard_file_rank(LeaderboardFile*, int points);
+void leaderboard_file_at(LeaderboardFile*, int rank, LeaderboardEntry* entry);
+unsigned char* leaderboard_file_merge(LeaderboardFile*, Leaderboard* delta, int max_entries,
+                                      uint32_t generation, size_t* len);
+LeaderboardFile* leaderboard_file_retain(LeaderboardFile*);
+void leaderboard_file_close(LeaderboardFile*);
+
+#endif
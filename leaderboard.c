@@ -0,0 +1,264 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "leaderboard.h"
+#include "encoding.h"
+
+#define LEADERBOARD_INITIAL_CAPACITY 64
+
+Leaderboard* leaderboard_init(int max_entries) {
+  Leaderboard* board = malloc(sizeof(Leaderboard));
+  board->capacity = LEADERBOARD_INITIAL_CAPACITY;
+  board->nodes = malloc(sizeof(LeaderboardNode) * board->capacity);
+  board->root = -1;
+  board->free_list = -1;
+  board->count = 0;
+  board->max_entries = max_entries;
+  board->next_seq = 0;
+  // Priorities only shape the tree, any fixed seed will do
+  rng_seed(&board->rng, 0x1eade7b0a7d);
+  return board;
+}
+
+/* Treap */
+
+int _leaderboard_size(Leaderboard* board, int node) {
+  return node < 0 ? 0 : board->nodes[node].size;
+}
+
+void _leaderboard_update(Leaderboard* board, int node) {
+  LeaderboardNode* n = &board->nodes[node];
+  n->size = 1 + _leaderboard_size(board, n->left) + _leaderboard_size(board, n->right);
+}
+
+/**
+ * Whether node a ranks above node b
+ */
+bool _leaderboard_before(Leaderboard* board, int a, int b) {
+  LeaderboardNode* x = &board->nodes[a];
+  LeaderboardNode* y = &board->nodes[b];
+  return x->entry.points > y->entry.points ||
+         (x->entry.points == y->entry.points && x->seq > y->seq);
+}
+
+/**
+ * Splits the tree at node into the nodes ranking above key and the rest
+ */
+void _leaderboard_split(Leaderboard* board, int node, int key, int* above, int* rest) {
+  if (node < 0) {
+    *above = *rest = -1;
+    return;
+  }
+  LeaderboardNode* n = &board->nodes[node];
+  if (_leaderboard_before(board, node, key)) {
+    _leaderboard_split(board, n->right, key, &n->right, rest);
+    *above = node;
+  } else {
+    _leaderboard_split(board, n->left, key, above, &n->left);
+    *rest = node;
+  }
+  _leaderboard_update(board, node);
+}
+
+int _leaderboard_insert_node(Leaderboard* board, int node, int key) {
+  if (node < 0) {
+    return key;
+  }
+  LeaderboardNode* n = &board->nodes[node];
+  LeaderboardNode* k = &board->nodes[key];
+  if (k->priority > n->priority) {
+    _leaderboard_split(board, node, key, &k->left, &k->right);
+    _leaderboard_update(board, key);
+    return key;
+  }
+  if (_leaderboard_before(board, key, node)) {
+    n->left = _leaderboard_insert_node(board, n->left, key);
+  } else {
+    n->right = _leaderboard_insert_node(board, n->right, key);
+  }
+  n->size++;
+  return node;
+}
+
+/**
+ * Unlinks the last ranked node under node. Returns the new subtree root.
+ */
+int _leaderboard_remove_last(Leaderboard* board, int node, int* removed) {
+  LeaderboardNode* n = &board->nodes[node];
+  if (n->right < 0) {
+    *removed = node;
+    return n->left;
+  }
+  n->right = _leaderboard_remove_last(board, n->right, removed);
+  n->size--;
+  return node;
+}
+
+int _leaderboard_new_node(Leaderboard* board) {
+  if (board->free_list >= 0) {
+    int node = board->free_list;
+    board->free_list = board->nodes[node].left;
+    return node;
+  }
+  if (board->count == board->capacity) {
+    board->capacity *= 2;
+    board->nodes = realloc(board->nodes, sizeof(LeaderboardNode) * board->capacity);
+  }
+  return board->count;
+}
+
+/**
+ * Adds an entry. Returns its rank, 0 being the best, or -1 if the board is
+ * full and the score is too low to stay on it.
+ */
+int leaderboard_insert(Leaderboard* board, const char* name, int points) {
+  int rank = leaderboard_rank(board, points);
+  if (rank >= board->max_entries) {
+    return -1;
+  }
+  if (board->count == board->max_entries) {
+    int removed;
+    board->root = _leaderboard_remove_last(board, board->root, &removed);
+    board->nodes[removed].left = board->free_list;
+    board->free_list = removed;
+    board->count--;
+  }
+
+  int node = _leaderboard_new_node(board);
+  LeaderboardNode* n = &board->nodes[node];
+  memset(n->entry.name, 0, LEADERBOARD_NAME_SIZE);
+  strncpy(n->entry.name, name, LEADERBOARD_NAME_SIZE - 1);
+  n->entry.points = points;
+  n->seq = board->next_seq++;
+  n->priority = rng_next(&board->rng);
+  n->left = -1;
+  n->right = -1;
+  n->size = 1;
+  board->root = _leaderboard_insert_node(board, board->root, node);
+  board->count++;
+  return rank;
+}
+
+/**
+ * The rank a new score of points would get: the number of entries that
+ * beat it.
+ */
+int leaderboard_rank(Leaderboard* board, int points) {
+  int rank = 0;
+  int node = board->root;
+  while (node >= 0) {
+    LeaderboardNode* n = &board->nodes[node];
+    if (n->entry.points > points) {
+      rank += _leaderboard_size(board, n->left) + 1;
+      node = n->right;
+    } else {
+      node = n->left;
+    }
+  }
+  return rank;
+}
+
+/**
+ * The entry at rank, or NULL past the end of the board
+ */
+const LeaderboardEntry* leaderboard_at(Leaderboard* board, int rank) {
+  if (rank < 0 || rank >= board->count) {
+    return NULL;
+  }
+  int node = board->root;
+  while (true) {
+    LeaderboardNode* n = &board->nodes[node];
+    int left = _leaderboard_size(board, n->left);
+    if (rank < left) {
+      node = n->left;
+    } else if (rank == left) {
+      return &n->entry;
+    } else {
+      rank -= left + 1;
+      node = n->right;
+    }
+  }
+}
+
+void _leaderboard_collect(Leaderboard* board, int node, LeaderboardEntry* entries, int max, int* count) {
+  if (node < 0 || *count >= max) {
+    return;
+  }
+  LeaderboardNode* n = &board->nodes[node];
+  _leaderboard_collect(board, n->left, entries, max, count);
+  if (*count < max) {
+    entries[(*count)++] = n->entry;
+  }
+  _leaderboard_collect(board, n->right, entries, max, count);
+}
+
+/**
+ * Copies out up to max of the best entries, best first. Returns how many.
+ */
+int leaderboard_top(Leaderboard* board, LeaderboardEntry* entries, int max) {
+  int count = 0;
+  _leaderboard_collect(board, board->root, entries, max, &count);
+  return count;
+}
+
+void leaderboard_free(Leaderboard* board) {
+  free(board->nodes);
+  free(board);
+}
+
+/* Log */
+
+void leaderboard_encode_header(unsigned char* header, uint32_t generation) {
+  memset(header, 0, LEADERBOARD_HEADER_SIZE);
+  memcpy(header, LEADERBOARD_MAGIC, 4);
+  header[4] = LEADERBOARD_VERSION;
+  encoding_put_u32(header + 8, generation);
+}
+
+void leaderboard_encode_record(const LeaderboardEntry* entry, unsigned char* record) {
+  memcpy(record, entry->name, LEADERBOARD_NAME_SIZE);
+  encoding_put_u32(record + 4, entry->points);
+  encoding_put_u32(record + 8, encoding_checksum(record, 8));
+}
+
+bool _leaderboard_decode_record(const unsigned char* record, LeaderboardEntry* entry) {
+  if (encoding_get_u32(record + 8) != encoding_checksum(record, 8)) {
+    return false;
+  }
+  memcpy(entry->name, record, LEADERBOARD_NAME_SIZE);
+  uint32_t points = encoding_get_u32(record + 4);
+  if (entry->name[0] == '\0' || entry->name[LEADERBOARD_NAME_SIZE - 1] != '\0' || points > INT32_MAX) {
+    return false;
+  }
+  entry->points = points;
+  return true;
+}
+
+/**
+ * Adds the entries of a log read into memory and gives its generation.
+ * Returns the length of the intact part, or 0 if it isn't a log at all.
+ * Anything after the intact part should be cut off before the log is
+ * appended to again.
+ */
+size_t leaderboard_load(Leaderboard* board, const unsigned char* log, size_t len, uint32_t* generation) {
+  // Version 1 had no generation
+  size_t offset = 8;
+  if (len < offset || memcmp(log, LEADERBOARD_MAGIC, 4) != 0 ||
+      (log[4] != 1 && log[4] != LEADERBOARD_VERSION)) {
+    return 0;
+  }
+  *generation = 0;
+  if (log[4] == LEADERBOARD_VERSION) {
+    if (len < LEADERBOARD_HEADER_SIZE) {
+      return 0;
+    }
+    *generation = encoding_get_u32(log + 8);
+    offset = LEADERBOARD_HEADER_SIZE;
+  }
+  LeaderboardEntry entry;
+  while (offset + LEADERBOARD_RECORD_SIZE <= len && _leaderboard_decode_record(log + offset, &entry)) {
+    leaderboard_insert(board, entry.name, entry.points);
+    offset += LEADERBOARD_RECORD_SIZE;
+  }
+  return offset;
+}
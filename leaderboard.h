@@ -0,0 +1,71 @@
+#ifndef LEADERBOARD_H
+#define LEADERBOARD_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "rng.h"
+
+/* Leaderboard */
+/* Every score ever entered, up to max_entries, ranked best first. Entries
+ * live in an order-statistic treap: a binary search tree on rank, kept
+ * balanced in expectation by random heap priorities, where every node knows
+ * the size of its subtree. Inserting, ranking a score and finding the entry
+ * at a rank are all O(log n). Nodes come from one pool array with a free
+ * list, so a steady-state board doesn't allocate.
+ * Equal scores rank newest first, as a new score that ties an old one takes
+ * its place on the table.
+ *
+ * A board can be kept as a log: "SNKL", a version byte, three zero bytes
+ * and the generation as 4 little-endian bytes (version 1 logs stop before
+ * the generation, which counts as 0), then one record per entry:
+ *   the name, NUL padded to 4 bytes, the points as 4 little-endian bytes and
+ *   an FNV-1a checksum of those 8 bytes as 4 little-endian bytes.
+ * New entries are appended, so reading the log in order inserts them in
+ * the order they were made. Reading stops at the first record that is
+ * short or fails its checksum: the torn end of an interrupted append.
+ */
+#define LEADERBOARD_NAME_SIZE 4 // Three letters and the terminator
+#define LEADERBOARD_MAGIC "SNKL"
+#define LEADERBOARD_VERSION 2
+#define LEADERBOARD_HEADER_SIZE 12
+#define LEADERBOARD_RECORD_SIZE 12
+
+typedef struct leaderboard_entry {
+  char name[LEADERBOARD_NAME_SIZE];
+  int points;
+} LeaderboardEntry;
+
+typedef struct leaderboard_node {
+  LeaderboardEntry entry;
+  uint32_t seq; // Insertion order, breaks ties
+  uint32_t priority;
+  int left; // Indices into the pool, -1 for none
+  int right;
+  int size; // Nodes in this subtree
+} LeaderboardNode;
+
+typedef struct leaderboard {
+  LeaderboardNode* nodes;
+  int capacity;
+  int root;
+  int free_list; // Chained through left
+  int count;
+  int max_entries; // The worst entry drops off past this
+  uint32_t next_seq;
+  Rng rng;
+} Leaderboard;
+
+Leaderboard* leaderboard_init(int max_entries);
+int leaderboard_insert(Leaderboard*, const char* name, int points);
+int leaderboard_rank(Leaderboard*, int points);
+const LeaderboardEntry* leaderboard_at(Leaderboard*, int rank);
+int leaderboard_top(Leaderboard*, LeaderboardEntry* entries, int max);
+void leaderboard_free(Leaderboard*);
+
+void leaderboard_encode_record(const LeaderboardEntry*, unsigned char* record);
+void leaderboard_encode_header(unsigned char* header, uint32_t generation);
+size_t leaderboard_load(Leaderboard*, const unsigned char* log, size_t len, uint32_t* generation);
+
+#endif
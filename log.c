@@ -0,0 +1,117 @@
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "log.h"
+
+/* Queued output, a byte ring of whole lines. Producers append under the
+ * lock; the writer copies a run out, writes it unlocked, then frees it.
+ */
+struct log_queue {
+  pthread_mutex_t lock;
+  pthread_cond_t ready;
+  char buffer[LOG_BUFFER_SIZE];
+  size_t head; // Next byte to fill, counting from the start
+  size_t tail; // Next byte to write out
+  unsigned long dropped;
+  bool running;
+  pthread_t writer;
+} log_queue = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER};
+
+const char* LOG_PREFIXES[] = {"error: ", "warning: ", "", ""};
+
+void* _log_writer(void* unused) {
+  (void)unused;
+  struct log_queue* queue = &log_queue;
+  char chunk[LOG_BUFFER_SIZE];
+  pthread_mutex_lock(&queue->lock);
+  while (true) {
+    while (queue->running && queue->head == queue->tail && queue->dropped == 0) {
+      pthread_cond_wait(&queue->ready, &queue->lock);
+    }
+    size_t len = queue->head - queue->tail;
+    unsigned long dropped = queue->dropped;
+    if (len == 0 && dropped == 0) {
+      // Stopped and drained
+      break;
+    }
+    size_t start = queue->tail % LOG_BUFFER_SIZE;
+    size_t first = len < LOG_BUFFER_SIZE - start ? len : LOG_BUFFER_SIZE - start;
+    memcpy(chunk, queue->buffer + start, first);
+    memcpy(chunk + first, queue->buffer, len - first);
+    queue->tail = queue->head;
+    queue->dropped = 0;
+    pthread_mutex_unlock(&queue->lock);
+
+    fwrite(chunk, 1, len, stderr);
+    if (dropped > 0) {
+      fprintf(stderr, "warning: log buffer full, dropped %lu messages\n", dropped);
+    }
+    fflush(stderr);
+    pthread_mutex_lock(&queue->lock);
+  }
+  pthread_mutex_unlock(&queue->lock);
+  return NULL;
+}
+
+void log_write(int level, const char* fmt, ...) {
+  char message[LOG_MESSAGE_MAX];
+  int prefix = snprintf(message, sizeof(message), "%s", LOG_PREFIXES[level]);
+  va_list args;
+  va_start(args, fmt);
+  int len = prefix + vsnprintf(message + prefix, sizeof(message) - prefix - 1, fmt, args);
+  va_end(args);
+  if (len > LOG_MESSAGE_MAX - 2) {
+    len = LOG_MESSAGE_MAX - 2;
+  }
+  message[len++] = '\n';
+
+  struct log_queue* queue = &log_queue;
+  pthread_mutex_lock(&queue->lock);
+  if (!queue->running) {
+    pthread_mutex_unlock(&queue->lock);
+    fwrite(message, 1, len, stderr);
+    return;
+  }
+  if (queue->head - queue->tail + len > LOG_BUFFER_SIZE) {
+    queue->dropped++;
+  } else {
+    for (int i = 0; i < len; i++) {
+      queue->buffer[(queue->head + i) % LOG_BUFFER_SIZE] = message[i];
+    }
+    queue->head += len;
+  }
+  pthread_cond_signal(&queue->ready);
+  pthread_mutex_unlock(&queue->lock);
+}
+
+/**
+ * Starts the background writer. Messages logged from now on are queued.
+ */
+void log_start() {
+  struct log_queue* queue = &log_queue;
+  pthread_mutex_lock(&queue->lock);
+  if (!queue->running && pthread_create(&queue->writer, NULL, _log_writer, NULL) == 0) {
+    queue->running = true;
+  }
+  pthread_mutex_unlock(&queue->lock);
+}
+
+/**
+ * Writes out everything queued and stops the writer. Later messages are
+ * written straight away again.
+ */
+void log_stop() {
+  struct log_queue* queue = &log_queue;
+  pthread_mutex_lock(&queue->lock);
+  if (!queue->running) {
+    pthread_mutex_unlock(&queue->lock);
+    return;
+  }
+  queue->running = false;
+  pthread_cond_signal(&queue->ready);
+  pthread_mutex_unlock(&queue->lock);
+  pthread_join(queue->writer, NULL);
+}
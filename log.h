@@ -0,0 +1,55 @@
+#ifndef LOG_H
+#define LOG_H
+
+/* Logging */
+/* Levelled logging to stderr. Levels above LOG_LEVEL compile to nothing,
+ * arguments and all, so debug logging costs nothing in normal builds.
+ * Once log_start has been called, messages are formatted by the caller and
+ * queued into a bounded buffer that a background thread writes out, so a
+ * slow terminal or pipe never stalls the game loop. When the buffer is full
+ * messages are dropped and counted rather than waited for. Before log_start,
+ * or without it (the headless tools), messages are written straight away.
+ */
+#define LOG_LEVEL_ERROR 0
+#define LOG_LEVEL_WARN 1
+#define LOG_LEVEL_INFO 2
+#define LOG_LEVEL_DEBUG 3
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#define LOG_BUFFER_SIZE 65536
+// Longer messages are cut short
+#define LOG_MESSAGE_MAX 1024
+
+// Never runs, but keeps the format checked and the arguments used
+#define _LOG_NOTHING(fmt, ...) \
+  do { \
+    if (0) { \
+      log_write(LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__); \
+    } \
+  } while (0)
+
+#define log_error(fmt, ...) log_write(LOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define log_warn(fmt, ...) log_write(LOG_LEVEL_WARN, fmt, ##__VA_ARGS__)
+#else
+#define log_warn _LOG_NOTHING
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define log_info(fmt, ...) log_write(LOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
+#else
+#define log_info _LOG_NOTHING
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define log_debug(fmt, ...) log_write(LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+#else
+#define log_debug _LOG_NOTHING
+#endif
+
+void log_write(int level, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+void log_start();
+void log_stop();
+
+#endif
@@ -0,0 +1,274 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "profile.h"
+#include "text-atlas.h"
+#include "font-cache.h"
+
+bool profile_enabled = false;
+// Set on the thread frames are built on, which alone counts allocations
+__thread bool profile_this_thread = false;
+
+// Frames ever written; only the writer stores it, with release order, so
+// a reader that loads it with acquire order sees every frame before it
+unsigned long profile_written = 0;
+ProfileFrame* profile_ring = NULL;
+
+// The frame being built
+ProfileFrame profile_current;
+double profile_epoch_ms;
+double profile_frame_start_ms;
+double profile_scope_entered_ms[PROFILE_NUM_SCOPES];
+
+const char* PROFILE_SCOPE_NAMES[] = {"events", "simulate", "advance", "draw", "draw_game",
+                                     "draw_score_entry", "draw_scores", "draw_hud", "present"};
+const char* PROFILE_COUNTER_NAMES[] = {"ticks", "game_events", "allocations", "blits", "font_opens"};
+
+double _profile_now_ms() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1e3 + now.tv_nsec / 1e6;
+}
+
+void profile_init() {
+  if (profile_enabled) {
+    return;
+  }
+  profile_ring = calloc(PROFILE_FRAMES, sizeof(ProfileFrame));
+  profile_epoch_ms = _profile_now_ms();
+  profile_enabled = true;
+  profile_this_thread = true;
+  profile_frame_begin();
+}
+
+void profile_frame_begin() {
+  if (!profile_enabled) {
+    return;
+  }
+  memset(&profile_current, 0, sizeof(ProfileFrame));
+  profile_frame_start_ms = _profile_now_ms();
+  profile_current.start_ms = profile_frame_start_ms - profile_epoch_ms;
+  for (int i = 0; i < PROFILE_NUM_SCOPES; i++) {
+    profile_current.scope_start_ms[i] = -1;
+  }
+}
+
+void profile_frame_end() {
+  if (!profile_enabled) {
+    return;
+  }
+  profile_current.work_ms = _profile_now_ms() - profile_frame_start_ms;
+  unsigned long written = profile_written;
+  profile_ring[written % PROFILE_FRAMES] = profile_current;
+  __atomic_store_n(&profile_written, written + 1, __ATOMIC_RELEASE);
+}
+
+void profile_scope_begin(ProfileScope scope) {
+  double now = _profile_now_ms();
+  profile_scope_entered_ms[scope] = now;
+  if (profile_current.scope_start_ms[scope] < 0) {
+    profile_current.scope_start_ms[scope] = now - profile_frame_start_ms;
+  }
+}
+
+void profile_scope_end(ProfileScope scope) {
+  profile_current.scope_ms[scope] += _profile_now_ms() - profile_scope_entered_ms[scope];
+}
+
+void profile_count(ProfileCounter counter, unsigned int n) {
+  profile_current.counters[counter] += n;
+}
+
+/**
+ * Copies up to max of the most recent frames, oldest first. Returns how many.
+ * Safe to call from any thread while frames are being written.
+ */
+int profile_recent_frames(ProfileFrame* frames, int max) {
+  if (!profile_enabled) {
+    return 0;
+  }
+  if (max > PROFILE_FRAMES) {
+    max = PROFILE_FRAMES;
+  }
+  unsigned long written = __atomic_load_n(&profile_written, __ATOMIC_ACQUIRE);
+  unsigned long first = written > (unsigned long)max ? written - max : 0;
+  for (unsigned long i = first; i < written; i++) {
+    frames[i - first] = profile_ring[i % PROFILE_FRAMES];
+  }
+  // The writer may have lapped us while we copied. The slot it is filling
+  // now held frame written_now - PROFILE_FRAMES, so drop that one and older.
+  unsigned long written_now = __atomic_load_n(&profile_written, __ATOMIC_ACQUIRE);
+  unsigned long intact = written_now >= PROFILE_FRAMES ? written_now - PROFILE_FRAMES + 1 : 0;
+  if (first < intact) {
+    unsigned long torn = intact - first;
+    if (torn >= written - first) {
+      return 0;
+    }
+    memmove(frames, frames + torn, sizeof(ProfileFrame) * (written - first - torn));
+    first = intact;
+  }
+  return written - first;
+}
+
+/* Allocation counting */
+/* The game is linked with --wrap for these, so calls from our own code land
+ * here. Allocations inside SDL aren't seen, nor are those of the logger and
+ * score writer threads, which would race the frame being built.
+ */
+void* __real_malloc(size_t);
+void* __real_calloc(size_t, size_t);
+void* __real_realloc(void*, size_t);
+
+void* __wrap_malloc(size_t size) {
+  if (profile_this_thread) {
+    profile_count(PROFILE_ALLOCATIONS, 1);
+  }
+  return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+  if (profile_this_thread) {
+    profile_count(PROFILE_ALLOCATIONS, 1);
+  }
+  return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+  if (profile_this_thread) {
+    profile_count(PROFILE_ALLOCATIONS, 1);
+  }
+  return __real_realloc(ptr, size);
+}
+
+/* Dumping */
+
+void _profile_dump_csv(FILE* file, ProfileFrame* frames, int count) {
+  fprintf(file, "frame,start_ms,work_ms");
+  for (int s = 0; s < PROFILE_NUM_SCOPES; s++) {
+    fprintf(file, ",%s_ms", PROFILE_SCOPE_NAMES[s]);
+  }
+  for (int c = 0; c < PROFILE_NUM_COUNTERS; c++) {
+    fprintf(file, ",%s", PROFILE_COUNTER_NAMES[c]);
+  }
+  fprintf(file, "\n");
+  for (int i = 0; i < count; i++) {
+    ProfileFrame* frame = &frames[i];
+    fprintf(file, "%d,%.3f,%.3f", i, frame->start_ms, frame->work_ms);
+    for (int s = 0; s < PROFILE_NUM_SCOPES; s++) {
+      fprintf(file, ",%.3f", frame->scope_ms[s]);
+    }
+    for (int c = 0; c < PROFILE_NUM_COUNTERS; c++) {
+      fprintf(file, ",%u", frame->counters[c]);
+    }
+    fprintf(file, "\n");
+  }
+}
+
+/**
+ * Chrome's trace event format (chrome://tracing, Perfetto). A scope entered
+ * more than once in a frame is shown as one span from its first entry.
+ */
+void _profile_dump_trace(FILE* file, ProfileFrame* frames, int count) {
+  fprintf(file, "{\"traceEvents\": [\n");
+  for (int i = 0; i < count; i++) {
+    ProfileFrame* frame = &frames[i];
+    double start_us = frame->start_ms * 1000;
+    fprintf(file, "%s{\"name\": \"frame\", \"ph\": \"X\", \"pid\": 1, \"tid\": 1, "
+            "\"ts\": %.1f, \"dur\": %.1f, \"args\": {",
+            i > 0 ? ",\n" : "", start_us, frame->work_ms * 1000);
+    for (int c = 0; c < PROFILE_NUM_COUNTERS; c++) {
+      fprintf(file, "%s\"%s\": %u", c > 0 ? ", " : "", PROFILE_COUNTER_NAMES[c], frame->counters[c]);
+    }
+    fprintf(file, "}}");
+    for (int s = 0; s < PROFILE_NUM_SCOPES; s++) {
+      if (frame->scope_start_ms[s] < 0) {
+        continue;
+      }
+      fprintf(file, ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": 1, "
+              "\"ts\": %.1f, \"dur\": %.1f}",
+              PROFILE_SCOPE_NAMES[s], start_us + frame->scope_start_ms[s] * 1000,
+              frame->scope_ms[s] * 1000);
+    }
+  }
+  fprintf(file, "\n]}\n");
+}
+
+/**
+ * Writes the frames still in the ring to path: Chrome trace JSON if it ends
+ * in .json, CSV otherwise.
+ */
+bool profile_dump(const char* path) {
+  FILE* file = fopen(path, "w");
+  if (file == NULL) {
+    return false;
+  }
+  ProfileFrame* frames = malloc(sizeof(ProfileFrame) * PROFILE_FRAMES);
+  int count = profile_recent_frames(frames, PROFILE_FRAMES);
+  size_t len = strlen(path);
+  if (len >= 5 && strcmp(path + len - 5, ".json") == 0) {
+    _profile_dump_trace(file, frames, count);
+  } else {
+    _profile_dump_csv(file, frames, count);
+  }
+  free(frames);
+  return fclose(file) == 0;
+}
+
+/* HUD */
+
+int _profile_compare_floats(const void* a, const void* b) {
+  float x = *(const float*)a;
+  float y = *(const float*)b;
+  return (x > y) - (x < y);
+}
+
+/**
+ * Draws frame timings over the top left corner of the screen. Returns the
+ * area it covered, which needs pushing to the display.
+ */
+SDL_Rect profile_hud_draw(SDL_Surface* screen) {
+  static SDL_Rect last = {0, 0, 0, 0};
+  SDL_Color fg = {0, 255, 0};
+  SDL_Color bg = {0, 0, 0};
+  TextAtlas* atlas = text_atlas_get(FONT_PATH, PROFILE_HUD_FONT_SIZE, fg, bg);
+  if (atlas == NULL) {
+    return last;
+  }
+
+  static ProfileFrame frames[PROFILE_HUD_FRAMES];
+  float work[PROFILE_HUD_FRAMES];
+  int count = profile_recent_frames(frames, PROFILE_HUD_FRAMES);
+  float scopes[PROFILE_NUM_SCOPES] = {0};
+  for (int i = 0; i < count; i++) {
+    work[i] = frames[i].work_ms;
+    for (int s = 0; s < PROFILE_NUM_SCOPES; s++) {
+      scopes[s] += frames[i].scope_ms[s] / count;
+    }
+  }
+  qsort(work, count, sizeof(float), _profile_compare_floats);
+
+  char lines[2][100];
+  snprintf(lines[0], sizeof(lines[0]), "frame p50 %.2fms p99 %.2fms max %.2fms",
+           count > 0 ? work[count / 2] : 0, count > 0 ? work[count * 99 / 100] : 0,
+           count > 0 ? work[count - 1] : 0);
+  snprintf(lines[1], sizeof(lines[1]), "events %.2f sim %.2f draw %.2f present %.2f",
+           scopes[PROFILE_EVENTS], scopes[PROFILE_SIMULATE], scopes[PROFILE_DRAW],
+           scopes[PROFILE_PRESENT]);
+
+  // Never shrinks, so it always covers what it drew last time
+  SDL_Rect area = {0, 0, last.w, 2 * atlas->height};
+  for (int i = 0; i < 2; i++) {
+    int width = text_atlas_width(atlas, lines[i]);
+    if (width > area.w) {
+      area.w = width;
+    }
+  }
+  SDL_FillRect(screen, &area, 0x00000000);
+  for (int i = 0; i < 2; i++) {
+    text_atlas_draw(atlas, screen, lines[i], 0, i * atlas->height);
+  }
+  last = area;
+  return area;
+}
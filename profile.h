@@ -0,0 +1,81 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdbool.h>
+#include <SDL/SDL.h>
+
+/* Frame profiler */
+/* Times the parts of each main loop pass that does work, and counts what it
+ * did. Each finished frame is pushed into a ring buffer that keeps the last
+ * PROFILE_FRAMES frames; the writer never blocks or takes a lock, readers
+ * copy frames out behind it. Everything is a no-op until profile_init turns
+ * it on, at the cost of one branch per scope. Frames are built on the thread
+ * that called profile_init; allocations on other threads aren't counted.
+ */
+#define PROFILE_FRAMES 8192
+// Frames the HUD percentiles are taken over
+#define PROFILE_HUD_FRAMES 120
+#define PROFILE_HUD_FONT_SIZE 12
+
+typedef enum profile_scope {
+  PROFILE_EVENTS, // Event pump
+  PROFILE_SIMULATE, // Catching the game up with real time
+  PROFILE_ADVANCE, // Inside game_advance, i.e. game_next_state; within simulate
+  PROFILE_DRAW, // Painting into the screen surface
+  PROFILE_DRAW_GAME, // The screens, within draw
+  PROFILE_DRAW_SCORE_ENTRY,
+  PROFILE_DRAW_SCORES,
+  PROFILE_DRAW_HUD,
+  PROFILE_PRESENT, // SDL_UpdateRect(s)
+  PROFILE_NUM_SCOPES
+} ProfileScope;
+
+typedef enum profile_counter {
+  PROFILE_TICKS, // Game ticks advanced
+  PROFILE_GAME_EVENTS, // Ticks on which the game changed
+  PROFILE_ALLOCATIONS, // malloc, calloc and realloc calls from our code on the main thread
+  PROFILE_BLITS, // Blits and fills
+  PROFILE_FONT_OPENS,
+  PROFILE_NUM_COUNTERS
+} ProfileCounter;
+
+typedef struct profile_frame {
+  double start_ms; // Since profile_init
+  float work_ms; // From frame begin to end; sleeping isn't part of a frame
+  float scope_start_ms[PROFILE_NUM_SCOPES]; // First entry, from frame start
+  float scope_ms[PROFILE_NUM_SCOPES]; // Total time inside
+  unsigned int counters[PROFILE_NUM_COUNTERS];
+} ProfileFrame;
+
+extern bool profile_enabled;
+
+#define PROFILE_BEGIN(scope) \
+  do { \
+    if (profile_enabled) { \
+      profile_scope_begin(scope); \
+    } \
+  } while (0)
+#define PROFILE_END(scope) \
+  do { \
+    if (profile_enabled) { \
+      profile_scope_end(scope); \
+    } \
+  } while (0)
+#define PROFILE_COUNT(counter, n) \
+  do { \
+    if (profile_enabled) { \
+      profile_count(counter, n); \
+    } \
+  } while (0)
+
+void profile_init();
+void profile_frame_begin();
+void profile_frame_end();
+void profile_scope_begin(ProfileScope);
+void profile_scope_end(ProfileScope);
+void profile_count(ProfileCounter, unsigned int n);
+int profile_recent_frames(ProfileFrame* frames, int max);
+bool profile_dump(const char* path);
+SDL_Rect profile_hud_draw(SDL_Surface* screen);
+
+#endif
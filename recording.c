@@ -0,0 +1,118 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "recording.h"
+
+void _recording_write_varint(FILE* file, uint64_t value) {
+  while (value >= 0x80) {
+    fputc((int)(value & 0x7f) | 0x80, file);
+    value >>= 7;
+  }
+  fputc((int)value, file);
+}
+
+bool _recording_read_varint(FILE* file, uint64_t* value) {
+  *value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    int byte = fgetc(file);
+    if (byte == EOF) {
+      return false;
+    }
+    *value |= (uint64_t)(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      return true;
+    }
+  }
+  // Longer than any 64 bit value
+  return false;
+}
+
+/**
+ * Starts a new recording, overwriting path. Returns NULL if it can't be written.
+ */
+Recording* recording_create(const char* path, uint64_t seed, int width, int height) {
+  FILE* file = fopen(path, "wb");
+  if (file == NULL) {
+    return NULL;
+  }
+  Recording* recording = malloc(sizeof(struct recording));
+  recording->file = file;
+  recording->seed = seed;
+  recording->width = width;
+  recording->height = height;
+  recording->last_tick = 0;
+
+  fwrite(RECORDING_MAGIC, 1, 4, file);
+  fputc(RECORDING_VERSION, file);
+  for (int i = 0; i < 8; i++) {
+    fputc((int)((seed >> (8 * i)) & 0xff), file);
+  }
+  _recording_write_varint(file, width);
+  _recording_write_varint(file, height);
+  return recording;
+}
+
+void recording_add(Recording* recording, unsigned long tick, int event) {
+  _recording_write_varint(recording->file, tick - recording->last_tick);
+  fputc(event, recording->file);
+  recording->last_tick = event == RECORDING_EVENT_RESET ? 0 : tick;
+}
+
+/**
+ * Opens a recording for playback. Returns NULL if it is missing or not a
+ * recording this version understands.
+ */
+Recording* recording_open(const char* path) {
+  FILE* file = fopen(path, "rb");
+  if (file == NULL) {
+    return NULL;
+  }
+  char magic[4];
+  uint64_t width, height;
+  uint64_t seed = 0;
+  bool valid = fread(magic, 1, 4, file) == 4 && memcmp(magic, RECORDING_MAGIC, 4) == 0 &&
+               fgetc(file) == RECORDING_VERSION;
+  for (int i = 0; valid && i < 8; i++) {
+    int byte = fgetc(file);
+    valid = byte != EOF;
+    seed |= (uint64_t)(byte & 0xff) << (8 * i);
+  }
+  valid = valid && _recording_read_varint(file, &width) && _recording_read_varint(file, &height) &&
+          width > 0 && width <= 1000 && height > 0 && height <= 1000;
+  if (!valid) {
+    fclose(file);
+    return NULL;
+  }
+
+  Recording* recording = malloc(sizeof(struct recording));
+  recording->file = file;
+  recording->seed = seed;
+  recording->width = width;
+  recording->height = height;
+  recording->last_tick = 0;
+  return recording;
+}
+
+/**
+ * Reads the next event and the tick it happened on. Returns false at the end
+ * of the file, or at a truncated record.
+ */
+bool recording_next(Recording* recording, unsigned long* tick, int* event) {
+  uint64_t delta;
+  if (!_recording_read_varint(recording->file, &delta)) {
+    return false;
+  }
+  int byte = fgetc(recording->file);
+  if (byte == EOF) {
+    return false;
+  }
+  *tick = recording->last_tick + delta;
+  *event = byte;
+  recording->last_tick = byte == RECORDING_EVENT_RESET ? 0 : *tick;
+  return true;
+}
+
+void recording_close(Recording* recording) {
+  fclose(recording->file);
+  free(recording);
+}
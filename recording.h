@@ -0,0 +1,40 @@
+#ifndef RECORDING_H
+#define RECORDING_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/* Session recording */
+/* A game is fully determined by its seed and the inputs it was given, so a
+ * session is recorded as just that. The file starts with a header:
+ *   "SNKR", a version byte, the seed as 8 little-endian bytes, then the
+ *   board width and height as varints
+ * followed by one record per event:
+ *   ticks since the previous event as a varint, then the event byte.
+ * Events are GameInput values, or one of the markers below. The game clock
+ * starts again from zero after a reset.
+ */
+#define RECORDING_MAGIC "SNKR"
+#define RECORDING_VERSION 1
+
+// New game; the tick is when the old one was reset
+#define RECORDING_EVENT_RESET 0x80
+// Session over; the tick is when it ended
+#define RECORDING_EVENT_END 0x81
+
+typedef struct recording {
+  FILE* file;
+  uint64_t seed;
+  int width;
+  int height;
+  unsigned long last_tick;
+} Recording;
+
+Recording* recording_create(const char* path, uint64_t seed, int width, int height);
+void recording_add(Recording*, unsigned long tick, int event);
+Recording* recording_open(const char* path);
+bool recording_next(Recording*, unsigned long* tick, int* event);
+void recording_close(Recording*);
+
+#endif
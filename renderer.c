@@ -0,0 +1,244 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "renderer.h"
+#include "font-cache.h"
+#include "profile.h"
+
+Renderer* renderer_init(SDL_Surface* screen, int width, int height,
+                        SDL_Surface* snake_square, SDL_Surface* hyper_square,
+                        SDL_Surface* berry_image, SDL_Surface* star_image) {
+  Renderer* renderer = malloc(sizeof(Renderer));
+  renderer->screen = screen;
+  renderer->snake_square = snake_square;
+  renderer->hyper_square = hyper_square;
+  renderer->berry_image = berry_image;
+  renderer->star_image = star_image;
+  SDL_Color fg = {255, 255, 255};
+  SDL_Color bg = {0, 0, 0};
+  renderer->score_atlas = text_atlas_get(FONT_PATH, RENDERER_SCORE_FONT_SIZE, fg, bg);
+  renderer->width = width;
+  renderer->height = height;
+  renderer->drawn = calloc(width * height, sizeof(unsigned char));
+  // Every cell, the score, and a couple for overlays
+  renderer->dirty = malloc(sizeof(SDL_Rect) * (width * height + RENDERER_EXTRA_DIRTY));
+  renderer->num_dirty = 0;
+  renderer->present_all = false;
+  renderer->score_rect = (SDL_Rect){0, 0, 0, 0};
+  renderer_invalidate(renderer);
+  return renderer;
+}
+
+/**
+ * Forgets what is on screen, e.g. after another screen has been painted over
+ * the game. The next frame repaints and pushes the whole window.
+ */
+void renderer_invalidate(Renderer* renderer) {
+  renderer->invalid = true;
+  renderer->score = -1;
+}
+
+/**
+ * Queues an area for the next renderer_present. Overlays drawn on top of the
+ * game after renderer_draw_game use this to go out in the same update.
+ */
+void renderer_add_dirty(Renderer* renderer, SDL_Rect rect) {
+  if (renderer->num_dirty < renderer->width * renderer->height + RENDERER_EXTRA_DIRTY) {
+    renderer->dirty[renderer->num_dirty++] = rect;
+  } else {
+    renderer->present_all = true;
+  }
+}
+
+/**
+ * The sprite on top of a cell. Same stacking as drawing them in turn: snake,
+ * then berries, then missiles.
+ */
+unsigned char _renderer_cell_sprite(Game* game, int x, int y) {
+  if (game_missile_at(game, x, y)) {
+    return SPRITE_MISSILE;
+  }
+  Berry* berry = game_berry_at(game, x, y);
+  if (berry != NULL) {
+    return berry->hyper ? SPRITE_STAR : SPRITE_BERRY;
+  }
+  if (snake_has_point_at(game->snake, x, y)) {
+    return game->hyperMode ? SPRITE_HYPER_SNAKE : SPRITE_SNAKE;
+  }
+  return SPRITE_NONE;
+}
+
+/**
+ * Blits a cell's sprite over whatever is already there.
+ */
+void _renderer_blit_sprite(Renderer* renderer, int x, int y) {
+  SDL_Rect dest = {x * RENDERER_CELL_SIZE, y * RENDERER_CELL_SIZE,
+                   RENDERER_CELL_SIZE, RENDERER_CELL_SIZE};
+  unsigned char sprite = renderer->drawn[y * renderer->width + x];
+  if (sprite != SPRITE_NONE) {
+    PROFILE_COUNT(PROFILE_BLITS, 1);
+  }
+  switch (sprite) {
+    case SPRITE_SNAKE:
+      SDL_BlitSurface(renderer->snake_square, NULL, renderer->screen, &dest);
+      break;
+    case SPRITE_HYPER_SNAKE:
+      SDL_BlitSurface(renderer->hyper_square, NULL, renderer->screen, &dest);
+      break;
+    case SPRITE_BERRY:
+      SDL_BlitSurface(renderer->berry_image, NULL, renderer->screen, &dest);
+      break;
+    case SPRITE_STAR:
+      SDL_BlitSurface(renderer->star_image, NULL, renderer->screen, &dest);
+      break;
+    case SPRITE_MISSILE:
+      SDL_FillRect(renderer->screen, &dest, 0xffffffff);
+      break;
+  }
+}
+
+/**
+ * Paints a cell from scratch and queues it for the screen update.
+ */
+void _renderer_paint_cell(Renderer* renderer, int x, int y) {
+  SDL_Rect dest = {x * RENDERER_CELL_SIZE, y * RENDERER_CELL_SIZE,
+                   RENDERER_CELL_SIZE, RENDERER_CELL_SIZE};
+  SDL_FillRect(renderer->screen, &dest, 0x00000000);
+  PROFILE_COUNT(PROFILE_BLITS, 1);
+  _renderer_blit_sprite(renderer, x, y);
+  renderer_add_dirty(renderer, dest);
+}
+
+bool _renderer_cell_in_rect(int x, int y, SDL_Rect* rect) {
+  int left = x * RENDERER_CELL_SIZE;
+  int top = y * RENDERER_CELL_SIZE;
+  return left < rect->x + rect->w && left + RENDERER_CELL_SIZE > rect->x &&
+         top < rect->y + rect->h && top + RENDERER_CELL_SIZE > rect->y;
+}
+
+/**
+ * Brings a cell up to date with the game. Cells under the score are left for
+ * _renderer_paint_score; returns true if one of those changed.
+ */
+bool _renderer_update_cell(Renderer* renderer, Game* game, int x, int y) {
+  int i = y * renderer->width + x;
+  unsigned char sprite = _renderer_cell_sprite(game, x, y);
+  if (sprite == renderer->drawn[i]) {
+    return false;
+  }
+  renderer->drawn[i] = sprite;
+  if (renderer->score_atlas != NULL && _renderer_cell_in_rect(x, y, &renderer->score_rect)) {
+    return true;
+  }
+  _renderer_paint_cell(renderer, x, y);
+  return false;
+}
+
+SDL_Rect _renderer_union(SDL_Rect a, SDL_Rect b) {
+  if (a.w == 0 || a.h == 0) {
+    return b;
+  }
+  int left = a.x < b.x ? a.x : b.x;
+  int top = a.y < b.y ? a.y : b.y;
+  int right = a.x + a.w > b.x + b.w ? a.x + a.w : b.x + b.w;
+  int bottom = a.y + a.h > b.y + b.h ? a.y + a.h : b.y + b.h;
+  return (SDL_Rect){left, top, right - left, bottom - top};
+}
+
+/**
+ * The score sits under the sprites in the bottom right corner. When it or
+ * any cell over it changes, the whole area is repainted in stacking order.
+ */
+void _renderer_paint_score(Renderer* renderer, int score) {
+  TextAtlas* atlas = renderer->score_atlas;
+  SDL_Rect area = renderer->score_rect;
+  if (score != renderer->score) {
+    snprintf(renderer->score_text, sizeof(renderer->score_text), "Score: %d", score);
+    renderer->score = score;
+  }
+  int text_width = text_atlas_width(atlas, renderer->score_text);
+  SDL_Rect text_rect = {renderer->width * RENDERER_CELL_SIZE - text_width - 10,
+                        renderer->height * RENDERER_CELL_SIZE - atlas->height - 10,
+                        text_width, atlas->height};
+  area = _renderer_union(area, text_rect);
+  SDL_FillRect(renderer->screen, &area, 0x00000000);
+  PROFILE_COUNT(PROFILE_BLITS, 1);
+  text_atlas_draw(atlas, renderer->screen, renderer->score_text, text_rect.x, text_rect.y);
+  renderer->score_rect = text_rect;
+
+  for (int y = area.y / RENDERER_CELL_SIZE; y <= (area.y + area.h - 1) / RENDERER_CELL_SIZE; y++) {
+    for (int x = area.x / RENDERER_CELL_SIZE; x <= (area.x + area.w - 1) / RENDERER_CELL_SIZE; x++) {
+      _renderer_blit_sprite(renderer, x, y);
+    }
+  }
+  renderer_add_dirty(renderer, area);
+}
+
+void _renderer_repaint(Renderer* renderer, Game* game) {
+  for (int y = 0; y < renderer->height; y++) {
+    for (int x = 0; x < renderer->width; x++) {
+      renderer->drawn[y * renderer->width + x] = _renderer_cell_sprite(game, x, y);
+    }
+  }
+  SDL_FillRect(renderer->screen, NULL, 0x00000000);
+  PROFILE_COUNT(PROFILE_BLITS, 1);
+  if (renderer->score_atlas != NULL) {
+    renderer->score_rect = (SDL_Rect){0, 0, 0, 0};
+    _renderer_paint_score(renderer, game_score(game));
+  }
+  for (int y = 0; y < renderer->height; y++) {
+    for (int x = 0; x < renderer->width; x++) {
+      _renderer_blit_sprite(renderer, x, y);
+    }
+  }
+  renderer->present_all = true;
+  renderer->invalid = false;
+}
+
+/**
+ * Brings the screen surface up to date with the game, redrawing only what
+ * changed. renderer_present then pushes it to the display.
+ */
+void renderer_draw_game(Renderer* renderer, Game* game) {
+  if (renderer->invalid) {
+    _renderer_repaint(renderer, game);
+  } else {
+    bool score_dirty = renderer->score_atlas != NULL && game_score(game) != renderer->score;
+    if (game->all_changed) {
+      for (int y = 0; y < renderer->height; y++) {
+        for (int x = 0; x < renderer->width; x++) {
+          score_dirty |= _renderer_update_cell(renderer, game, x, y);
+        }
+      }
+    } else {
+      for (int i = 0; i < game->changed_cells->count; i++) {
+        struct point cell = cell_set_at(game->changed_cells, i);
+        score_dirty |= _renderer_update_cell(renderer, game, cell.x, cell.y);
+      }
+    }
+    if (score_dirty) {
+      _renderer_paint_score(renderer, game_score(game));
+    }
+  }
+  game_clear_changed(game);
+}
+
+/**
+ * Pushes everything drawn since the last present to the display.
+ */
+void renderer_present(Renderer* renderer) {
+  if (renderer->present_all) {
+    SDL_UpdateRect(renderer->screen, 0, 0, 0, 0);
+  } else if (renderer->num_dirty > 0) {
+    SDL_UpdateRects(renderer->screen, renderer->num_dirty, renderer->dirty);
+  }
+  renderer->num_dirty = 0;
+  renderer->present_all = false;
+}
+
+void renderer_free(Renderer* renderer) {
+  free(renderer->drawn);
+  free(renderer->dirty);
+  free(renderer);
+}
@@ -0,0 +1,60 @@
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include <stdbool.h>
+#include <SDL/SDL.h>
+
+#include "game.h"
+#include "text-atlas.h"
+
+/* In-game renderer */
+/* Remembers what is on screen in every cell and, each frame, redraws and
+ * pushes only the cells that changed, plus the score when it changes. The game
+ * lists the cells it changed, so a frame only looks at those; drawing one
+ * clears the list.
+ * Drawing and pushing to the display are separate steps, so overlays can be
+ * drawn in between and go out in the same update.
+ */
+#define RENDERER_CELL_SIZE 10
+#define RENDERER_SCORE_FONT_SIZE 16
+// Dirty rects beyond one per cell: the score and overlays
+#define RENDERER_EXTRA_DIRTY 4
+
+typedef enum cell_sprite {
+  SPRITE_NONE,
+  SPRITE_SNAKE,
+  SPRITE_HYPER_SNAKE,
+  SPRITE_BERRY,
+  SPRITE_STAR,
+  SPRITE_MISSILE
+} CellSprite;
+
+typedef struct renderer {
+  SDL_Surface* screen;
+  SDL_Surface* snake_square;
+  SDL_Surface* hyper_square;
+  SDL_Surface* berry_image;
+  SDL_Surface* star_image;
+  TextAtlas* score_atlas;
+  int width;
+  int height;
+  unsigned char* drawn; // Sprite on screen per cell
+  bool invalid; // Repaint everything on the next frame
+  int score;
+  char score_text[20];
+  SDL_Rect score_rect;
+  SDL_Rect* dirty; // Waiting for renderer_present
+  int num_dirty;
+  bool present_all;
+} Renderer;
+
+Renderer* renderer_init(SDL_Surface* screen, int width, int height,
+                        SDL_Surface* snake_square, SDL_Surface* hyper_square,
+                        SDL_Surface* berry_image, SDL_Surface* star_image);
+void renderer_invalidate(Renderer*);
+void renderer_draw_game(Renderer*, Game*);
+void renderer_add_dirty(Renderer*, SDL_Rect);
+void renderer_present(Renderer*);
+void renderer_free(Renderer*);
+
+#endif
@@ -0,0 +1,117 @@
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "game.h"
+#include "recording.h"
+
+/* Replay */
+/* Plays a recorded session back through the simulation core as fast as
+ * possible, with no rendering, and prints the state it ends in. The digest
+ * covers the snake, berries, missiles, clock and random state, so two builds
+ * that replay a session differently print different digests.
+ */
+
+double replay_seconds() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+uint64_t _replay_mix(uint64_t digest, uint64_t value) {
+  // FNV-1a, a byte at a time
+  for (int i = 0; i < 8; i++) {
+    digest ^= (value >> (8 * i)) & 0xff;
+    digest *= 0x100000001b3ULL;
+  }
+  return digest;
+}
+
+uint64_t replay_state_digest(Game* game) {
+  uint64_t digest = 0xcbf29ce484222325ULL;
+  digest = _replay_mix(digest, game->tick);
+  digest = _replay_mix(digest, game->gameOver);
+  digest = _replay_mix(digest, game->snake->berriesEaten);
+  for (int i = 0; i < game->snake->num_points; i++) {
+    struct point* point = snake_point(game->snake, i);
+    digest = _replay_mix(digest, point->y * game->width + point->x);
+  }
+  for (int i = 0; i < game->berries->count; i++) {
+    Berry* berry = &game->berries->berries[i];
+    digest = _replay_mix(digest, berry->location.y * game->width + berry->location.x);
+    digest = _replay_mix(digest, berry->hyper);
+  }
+  for (int i = 0; i < game->missiles->count; i++) {
+    digest = _replay_mix(digest, game->missiles->y[i] * game->width + game->missiles->x[i]);
+  }
+  digest = _replay_mix(digest, game->rng.state);
+  return digest;
+}
+
+/**
+ * Runs the game up to the given tick. The clock stands still once the game
+ * is paused or over, which is where the recorded game would have stayed too.
+ */
+void replay_advance_to(Game* game, unsigned long tick) {
+  while (game->tick < tick) {
+    if (game_advance(game, tick - game->tick) == 0) {
+      return;
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+  if (argc != 2) {
+    fprintf(stderr, "Usage: %s recording\n", argv[0]);
+    return 1;
+  }
+  Recording* recording = recording_open(argv[1]);
+  if (recording == NULL) {
+    fprintf(stderr, "%s: not a snake recording\n", argv[1]);
+    return 1;
+  }
+
+  Game* game = game_init(recording->width, recording->height, recording->seed);
+  unsigned long games = 1;
+  unsigned long inputs = 0;
+  unsigned long ticks = 0;
+  bool ended = false;
+
+  double start = replay_seconds();
+  unsigned long tick;
+  int event;
+  while (!ended && recording_next(recording, &tick, &event)) {
+    unsigned long before = game->tick;
+    replay_advance_to(game, tick);
+    ticks += game->tick - before;
+    switch (event) {
+      case RECORDING_EVENT_RESET:
+        printf("game %lu: score %d ticks %lu\n", games, game_score(game), game->tick);
+        game_reset(game);
+        games++;
+        break;
+      case RECORDING_EVENT_END:
+        ended = true;
+        break;
+      default:
+        game_handle_input(game, (GameInput)event);
+        inputs++;
+        break;
+    }
+  }
+  double elapsed = replay_seconds() - start;
+
+  if (!ended) {
+    fprintf(stderr, "%s: recording is truncated, stopped at its last event\n", argv[1]);
+  }
+  printf("game %lu: score %d ticks %lu%s\n", games, game_score(game), game->tick,
+         game->gameOver ? "" : " (unfinished)");
+  printf("seed: %llu games: %lu inputs: %lu ticks: %lu seconds: %.3f digest: %016llx\n",
+         (unsigned long long)recording->seed, games, inputs, ticks, elapsed,
+         (unsigned long long)replay_state_digest(game));
+
+  game_free(game);
+  recording_close(recording);
+  return ended ? 0 : 1;
+}
@@ -0,0 +1,47 @@
+
+#include "rng.h"
+
+/**
+ * splitmix64 step, used to spread a single seed over state and stream
+ */
+uint64_t _rng_splitmix64(uint64_t* x) {
+  uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+/**
+ * Seeds the generator. Nearby seeds (e.g. base + instance number) still give
+ * unrelated sequences, since the seed picks both the start and the stream.
+ */
+void rng_seed(Rng* rng, uint64_t seed) {
+  uint64_t mix = seed;
+  uint64_t initstate = _rng_splitmix64(&mix);
+  rng->state = 0;
+  rng->inc = (_rng_splitmix64(&mix) << 1) | 1;
+  rng_next(rng);
+  rng->state += initstate;
+  rng_next(rng);
+}
+
+uint32_t rng_next(Rng* rng) {
+  uint64_t oldstate = rng->state;
+  rng->state = oldstate * 6364136223846793005ULL + rng->inc;
+  uint32_t xorshifted = ((oldstate >> 18) ^ oldstate) >> 27;
+  uint32_t rot = oldstate >> 59;
+  return (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
+}
+
+/**
+ * Uniform number in [0, bound), without modulo bias
+ */
+uint32_t rng_below(Rng* rng, uint32_t bound) {
+  uint32_t threshold = -bound % bound;
+  for (;;) {
+    uint32_t r = rng_next(rng);
+    if (r >= threshold) {
+      return r % bound;
+    }
+  }
+}
@@ -0,0 +1,19 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+/* Random number generator */
+/* PCG32 (pcg-random.org): small, fast and fully determined by its seed, so a
+ * game replays identically given the same seed.
+ */
+typedef struct rng {
+  uint64_t state;
+  uint64_t inc; // Selects the stream; always odd
+} Rng;
+
+void rng_seed(Rng*, uint64_t seed);
+uint32_t rng_next(Rng*);
+uint32_t rng_below(Rng*, uint32_t bound);
+
+#endif
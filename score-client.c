@@ -0,0 +1,238 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "score-client.h"
+
+/**
+ * Connects to the server listening on socket_path. Returns NULL if there
+ * isn't one.
+ */
+ScoreClient* score_client_connect(const char* socket_path) {
+  struct sockaddr_un address;
+  if (strlen(socket_path) >= sizeof(address.sun_path)) {
+    errno = ENAMETOOLONG;
+    return NULL;
+  }
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  strcpy(address.sun_path, socket_path);
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    return NULL;
+  }
+  struct timeval timeout = {SCORE_CLIENT_TIMEOUT_MS / 1000, SCORE_CLIENT_TIMEOUT_MS % 1000 * 1000};
+  if (connect(fd, (struct sockaddr*)&address, sizeof(address)) != 0 ||
+      setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) != 0 ||
+      setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout)) != 0) {
+    int error = errno;
+    close(fd);
+    errno = error;
+    return NULL;
+  }
+  ScoreClient* client = malloc(sizeof(ScoreClient));
+  client->fd = fd;
+  client->next_id = 0;
+  client->unanswered = 0;
+  client->used = 0;
+  score_buffer_init(&client->in);
+  score_buffer_init(&client->out);
+  return client;
+}
+
+/**
+ * Reads whatever has arrived into in, waiting for some if wait is set
+ */
+bool _score_client_receive(ScoreClient* client, bool wait) {
+  score_buffer_reserve(&client->in, SCORE_PROTOCOL_MAX_FRAME);
+  ssize_t got = recv(client->fd, client->in.data + client->in.len, client->in.cap - client->in.len,
+                     wait ? 0 : MSG_DONTWAIT);
+  if (got > 0) {
+    client->in.len += got;
+    return true;
+  }
+  if (got < 0 && errno == EINTR) {
+    return true;
+  }
+  return !wait && got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
+/**
+ * Takes the next frame that isn't the reply to a fire and forget submit.
+ * Returns false if it hasn't all arrived yet, or on a malformed frame, which
+ * clears the payload's ok.
+ */
+bool _score_client_next_reply(ScoreClient* client, ScoreReader* payload) {
+  score_buffer_consume(&client->in, client->used);
+  client->used = 0;
+  while (score_buffer_next_frame(&client->in, payload, &client->used)) {
+    if (client->unanswered == 0 || payload->data[0] != SCORE_SUBMITTED) {
+      return true;
+    }
+    client->unanswered--;
+    score_buffer_consume(&client->in, client->used);
+    client->used = 0;
+  }
+  return false;
+}
+
+/**
+ * Skips the replies to earlier submits that have already arrived, so they
+ * don't back up behind a client that only ever submits
+ */
+bool _score_client_skip_replies(ScoreClient* client) {
+  ScoreReader payload;
+  if (client->unanswered == 0) {
+    return true;
+  }
+  if (!_score_client_receive(client, false)) {
+    return false;
+  }
+  if (_score_client_next_reply(client, &payload)) {
+    // Nothing else is outstanding, so this can't be a reply we want
+    return false;
+  }
+  return payload.ok;
+}
+
+/**
+ * Waits for the reply to request id, which must be the next one. Returns
+ * a reader over its body, good until the next reply is read.
+ */
+bool _score_client_reply(ScoreClient* client, uint32_t id, ScoreMessage type, ScoreReader* body) {
+  while (!_score_client_next_reply(client, body)) {
+    if (!body->ok || !_score_client_receive(client, true)) {
+      return false;
+    }
+  }
+  return score_reader_u8(body) == type && score_reader_u32(body) == id;
+}
+
+bool _score_client_send(ScoreClient* client) {
+  size_t sent = 0;
+  while (sent < client->out.len) {
+    ssize_t wrote = send(client->fd, client->out.data + sent, client->out.len - sent, MSG_NOSIGNAL);
+    if (wrote < 0 && errno != EINTR) {
+      break;
+    }
+    sent += wrote > 0 ? wrote : 0;
+  }
+  bool done = sent == client->out.len;
+  client->out.len = 0;
+  return done;
+}
+
+/**
+ * Submits n entries, in batches of up to SCORE_PROTOCOL_MAX_BATCH. If
+ * ranks is set, waits for the rank each entry got, or -1 if it was
+ * rejected; otherwise doesn't wait.
+ */
+bool score_client_submit(ScoreClient* client, const LeaderboardEntry* entries, int n, int* ranks) {
+  if (!_score_client_skip_replies(client)) {
+    return false;
+  }
+  uint32_t first_id = client->next_id;
+  for (int i = 0; i < n; i += SCORE_PROTOCOL_MAX_BATCH) {
+    int batch = n - i < SCORE_PROTOCOL_MAX_BATCH ? n - i : SCORE_PROTOCOL_MAX_BATCH;
+    size_t frame = score_buffer_begin_frame(&client->out, SCORE_SUBMIT, client->next_id++);
+    score_buffer_put_u16(&client->out, batch);
+    for (int j = 0; j < batch; j++) {
+      score_buffer_put_entry(&client->out, &entries[i + j]);
+    }
+    score_buffer_end_frame(&client->out, frame);
+  }
+  if (!_score_client_send(client)) {
+    return false;
+  }
+  if (ranks == NULL) {
+    client->unanswered += client->next_id - first_id;
+    return true;
+  }
+
+  ScoreReader body;
+  for (int i = 0; i < n; i += SCORE_PROTOCOL_MAX_BATCH) {
+    int batch = n - i < SCORE_PROTOCOL_MAX_BATCH ? n - i : SCORE_PROTOCOL_MAX_BATCH;
+    if (!_score_client_reply(client, first_id++, SCORE_SUBMITTED, &body) ||
+        score_reader_u16(&body) != batch) {
+      return false;
+    }
+    for (int j = 0; j < batch; j++) {
+      uint32_t rank = score_reader_u32(&body);
+      ranks[i + j] = rank == SCORE_PROTOCOL_NO_RANK ? -1 : (int)rank;
+    }
+  }
+  return body.ok;
+}
+
+/**
+ * The rank a new score of each of points would get, asked all at once.
+ * count, if set, gets the number of entries on the board.
+ */
+bool score_client_ranks(ScoreClient* client, const int* points, int n, int* ranks, int* count) {
+  if (!_score_client_skip_replies(client)) {
+    return false;
+  }
+  uint32_t first_id = client->next_id;
+  for (int i = 0; i < n; i++) {
+    size_t frame = score_buffer_begin_frame(&client->out, SCORE_RANK, client->next_id++);
+    score_buffer_put_u32(&client->out, points[i] > 0 ? points[i] : 0);
+    score_buffer_end_frame(&client->out, frame);
+  }
+  if (!_score_client_send(client)) {
+    return false;
+  }
+  ScoreReader body;
+  for (int i = 0; i < n; i++) {
+    if (!_score_client_reply(client, first_id + i, SCORE_RANKED, &body)) {
+      return false;
+    }
+    ranks[i] = score_reader_u32(&body);
+    uint32_t board_count = score_reader_u32(&body);
+    if (count != NULL) {
+      *count = board_count;
+    }
+    if (!body.ok) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Copies out up to max of the best entries, best first. Returns how many,
+ * or -1 on failure.
+ */
+int score_client_top(ScoreClient* client, LeaderboardEntry* entries, int max) {
+  if (max > SCORE_PROTOCOL_MAX_TOP) {
+    max = SCORE_PROTOCOL_MAX_TOP;
+  }
+  if (!_score_client_skip_replies(client)) {
+    return -1;
+  }
+  uint32_t id = client->next_id++;
+  size_t frame = score_buffer_begin_frame(&client->out, SCORE_TOP, id);
+  score_buffer_put_u16(&client->out, max);
+  score_buffer_end_frame(&client->out, frame);
+  ScoreReader body;
+  if (!_score_client_send(client) || !_score_client_reply(client, id, SCORE_TOP_REPLY, &body)) {
+    return -1;
+  }
+  int count = score_reader_u16(&body);
+  if (count > max) {
+    return -1;
+  }
+  for (int i = 0; i < count; i++) {
+    score_reader_entry(&body, &entries[i]);
+  }
+  return body.ok ? count : -1;
+}
+
+void score_client_close(ScoreClient* client) {
+  close(client->fd);
+  score_buffer_free(&client->in);
+  score_buffer_free(&client->out);
+  free(client);
+}
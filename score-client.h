@@ -0,0 +1,35 @@
+#ifndef SCORE_CLIENT_H
+#define SCORE_CLIENT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "score-protocol.h"
+
+/* Score server client */
+/* A blocking connection to snake-scored (see score-protocol.h). Requests
+ * made together go out in one write and their replies are read back
+ * together, so a batch costs one round trip rather than one per request.
+ * Submits without ranks don't wait at all: their replies are skipped
+ * whenever replies are next read. A call that gets no reply within
+ * SCORE_CLIENT_TIMEOUT_MS fails, and after any failure the connection
+ * is no good and should be closed.
+ */
+#define SCORE_CLIENT_TIMEOUT_MS 1000
+
+typedef struct score_client {
+  int fd;
+  uint32_t next_id;
+  int unanswered; // Submits sent whose replies are to be skipped
+  size_t used; // Bytes at the front of in taken by the last reply
+  ScoreBuffer in;
+  ScoreBuffer out;
+} ScoreClient;
+
+ScoreClient* score_client_connect(const char* socket_path);
+bool score_client_submit(ScoreClient*, const LeaderboardEntry* entries, int n, int* ranks);
+bool score_client_ranks(ScoreClient*, const int* points, int n, int* ranks, int* count);
+int score_client_top(ScoreClient*, LeaderboardEntry* entries, int max);
+void score_client_close(ScoreClient*);
+
+#endif
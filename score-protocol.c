@@ -0,0 +1,157 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "score-protocol.h"
+
+/* Buffers */
+
+void score_buffer_init(ScoreBuffer* buffer) {
+  buffer->data = NULL;
+  buffer->len = 0;
+  buffer->cap = 0;
+}
+
+void score_buffer_free(ScoreBuffer* buffer) {
+  free(buffer->data);
+  score_buffer_init(buffer);
+}
+
+void score_buffer_reserve(ScoreBuffer* buffer, size_t extra) {
+  if (buffer->len + extra <= buffer->cap) {
+    return;
+  }
+  size_t cap = buffer->cap > 0 ? buffer->cap : 256;
+  while (cap < buffer->len + extra) {
+    cap *= 2;
+  }
+  buffer->data = realloc(buffer->data, cap);
+  buffer->cap = cap;
+}
+
+/**
+ * Drops len bytes from the front
+ */
+void score_buffer_consume(ScoreBuffer* buffer, size_t len) {
+  if (len == 0) {
+    return;
+  }
+  memmove(buffer->data, buffer->data + len, buffer->len - len);
+  buffer->len -= len;
+}
+
+void _score_buffer_put(ScoreBuffer* buffer, const void* data, size_t len) {
+  score_buffer_reserve(buffer, len);
+  memcpy(buffer->data + buffer->len, data, len);
+  buffer->len += len;
+}
+
+void score_buffer_put_u16(ScoreBuffer* buffer, uint16_t value) {
+  unsigned char bytes[2] = {value & 0xff, value >> 8};
+  _score_buffer_put(buffer, bytes, 2);
+}
+
+void score_buffer_put_u32(ScoreBuffer* buffer, uint32_t value) {
+  unsigned char bytes[4];
+  for (int i = 0; i < 4; i++) {
+    bytes[i] = (value >> (8 * i)) & 0xff;
+  }
+  _score_buffer_put(buffer, bytes, 4);
+}
+
+void score_buffer_put_entry(ScoreBuffer* buffer, const LeaderboardEntry* entry) {
+  _score_buffer_put(buffer, entry->name, LEADERBOARD_NAME_SIZE);
+  score_buffer_put_u32(buffer, entry->points);
+}
+
+/**
+ * Starts a frame; the length is filled in by score_buffer_end_frame with
+ * what this returns.
+ */
+size_t score_buffer_begin_frame(ScoreBuffer* buffer, ScoreMessage type, uint32_t id) {
+  size_t frame = buffer->len;
+  score_buffer_put_u32(buffer, 0);
+  unsigned char byte = type;
+  _score_buffer_put(buffer, &byte, 1);
+  score_buffer_put_u32(buffer, id);
+  return frame;
+}
+
+void score_buffer_end_frame(ScoreBuffer* buffer, size_t frame) {
+  uint32_t len = buffer->len - frame - 4;
+  for (int i = 0; i < 4; i++) {
+    buffer->data[frame + i] = (len >> (8 * i)) & 0xff;
+  }
+}
+
+/**
+ * Finds the first whole frame in received bytes. Returns false if there
+ * isn't one yet, or if its length is out of range, which clears payload's
+ * ok. Consume frame_len bytes once done with the payload.
+ */
+bool score_buffer_next_frame(ScoreBuffer* buffer, ScoreReader* payload, size_t* frame_len) {
+  *frame_len = 0;
+  payload->ok = true;
+  if (buffer->len < 4) {
+    return false;
+  }
+  ScoreReader header = {buffer->data, 4, 0, true};
+  uint32_t len = score_reader_u32(&header);
+  if (len < 5 || len > SCORE_PROTOCOL_MAX_FRAME) {
+    payload->ok = false;
+    return false;
+  }
+  if (buffer->len < 4 + (size_t)len) {
+    return false;
+  }
+  payload->data = buffer->data + 4;
+  payload->len = len;
+  payload->pos = 0;
+  *frame_len = 4 + len;
+  return true;
+}
+
+/* Reading */
+
+bool _score_reader_has(ScoreReader* reader, size_t len) {
+  if (reader->pos + len > reader->len) {
+    reader->ok = false;
+    return false;
+  }
+  return true;
+}
+
+int score_reader_u8(ScoreReader* reader) {
+  if (!_score_reader_has(reader, 1)) {
+    return 0;
+  }
+  return reader->data[reader->pos++];
+}
+
+uint16_t score_reader_u16(ScoreReader* reader) {
+  if (!_score_reader_has(reader, 2)) {
+    return 0;
+  }
+  const unsigned char* in = reader->data + reader->pos;
+  reader->pos += 2;
+  return in[0] | in[1] << 8;
+}
+
+uint32_t score_reader_u32(ScoreReader* reader) {
+  if (!_score_reader_has(reader, 4)) {
+    return 0;
+  }
+  const unsigned char* in = reader->data + reader->pos;
+  reader->pos += 4;
+  return in[0] | in[1] << 8 | in[2] << 16 | (uint32_t)in[3] << 24;
+}
+
+void score_reader_entry(ScoreReader* reader, LeaderboardEntry* entry) {
+  memset(entry->name, 0, LEADERBOARD_NAME_SIZE);
+  if (_score_reader_has(reader, LEADERBOARD_NAME_SIZE)) {
+    memcpy(entry->name, reader->data + reader->pos, LEADERBOARD_NAME_SIZE - 1);
+    reader->pos += LEADERBOARD_NAME_SIZE;
+  }
+  entry->points = score_reader_u32(reader);
+}
+
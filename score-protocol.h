@@ -0,0 +1,78 @@
+#ifndef SCORE_PROTOCOL_H
+#define SCORE_PROTOCOL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "leaderboard.h"
+
+/* Score server protocol */
+/* Spoken over a Unix socket between snake-scored, which owns a leaderboard,
+ * and the games and simulators on the same host. Every message is a frame:
+ *   the payload length as 4 little-endian bytes, then the payload: a type
+ *   byte, the request id as 4 little-endian bytes and a body.
+ * Numbers are little-endian, names are 4 bytes NUL padded. Clients may send
+ * any number of requests without waiting: the server answers each in the
+ * order they arrived, with a reply carrying the request's id.
+ *   SUBMIT: count (2 bytes), then count entries of name and points (4 bytes).
+ *     Reply SUBMITTED: count (2 bytes), then the rank each entry got
+ *     (4 bytes), or SCORE_PROTOCOL_NO_RANK if it was rejected.
+ *   RANK: points (4 bytes).
+ *     Reply RANKED: the rank a new score of points would get, then the
+ *     number of entries on the board (4 bytes each).
+ *   TOP: max (2 bytes).
+ *     Reply TOP: count (2 bytes), then count entries, best first.
+ * A malformed request gets an ERROR reply and the connection is closed. The
+ * reply carries the request's id, or 0 if the frame's length was out of
+ * range, as then the id can't be trusted.
+ */
+#define SCORE_PROTOCOL_MAX_FRAME 65536
+#define SCORE_PROTOCOL_MAX_BATCH 4096 // Entries per SUBMIT
+#define SCORE_PROTOCOL_MAX_TOP 1000
+#define SCORE_PROTOCOL_ENTRY_SIZE 8 // Name and points
+#define SCORE_PROTOCOL_NO_RANK 0xffffffff
+#define SCORE_PROTOCOL_SOCKET_FILE "scores.sock" // snake-scored's default, in its directory
+
+typedef enum score_message {
+  SCORE_SUBMIT = 1,
+  SCORE_RANK = 2,
+  SCORE_TOP = 3,
+  SCORE_SUBMITTED = 0x81,
+  SCORE_RANKED = 0x82,
+  SCORE_TOP_REPLY = 0x83,
+  SCORE_ERROR = 0xff
+} ScoreMessage;
+
+// Bytes queued for the socket, or received and not yet used
+typedef struct score_buffer {
+  unsigned char* data;
+  size_t len;
+  size_t cap;
+} ScoreBuffer;
+
+// Walks a received payload. Reads past the end yield zero and clear ok.
+typedef struct score_reader {
+  const unsigned char* data;
+  size_t len;
+  size_t pos;
+  bool ok;
+} ScoreReader;
+
+void score_buffer_init(ScoreBuffer*);
+void score_buffer_free(ScoreBuffer*);
+void score_buffer_reserve(ScoreBuffer*, size_t extra);
+void score_buffer_consume(ScoreBuffer*, size_t len);
+size_t score_buffer_begin_frame(ScoreBuffer*, ScoreMessage type, uint32_t id);
+void score_buffer_end_frame(ScoreBuffer*, size_t frame);
+void score_buffer_put_u16(ScoreBuffer*, uint16_t);
+void score_buffer_put_u32(ScoreBuffer*, uint32_t);
+void score_buffer_put_entry(ScoreBuffer*, const LeaderboardEntry*);
+bool score_buffer_next_frame(ScoreBuffer*, ScoreReader* payload, size_t* frame_len);
+
+int score_reader_u8(ScoreReader*);
+uint16_t score_reader_u16(ScoreReader*);
+uint32_t score_reader_u32(ScoreReader*);
+void score_reader_entry(ScoreReader*, LeaderboardEntry*);
+
+#endif
@@ -0,0 +1,209 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "score-writer.h"
+#include "atomic-file.h"
+#include "log.h"
+
+/**
+ * Replaces the board file, then starts an empty log for it, on the calling
+ * thread. Returns false, leaving both as they were, if the board can't be
+ * written.
+ */
+bool score_writer_save_board(const char* board_path, const char* log_path, LeaderboardFile* board) {
+  if (!atomic_file_write(board_path, board->data, board->len)) {
+    log_error("Unable to save high scores to %s: %s", board_path, strerror(errno));
+    return false;
+  }
+  unsigned char header[LEADERBOARD_HEADER_SIZE];
+  leaderboard_encode_header(header, board->generation);
+  if (!atomic_file_write(log_path, header, sizeof(header))) {
+    log_error("Unable to start a new log at %s: %s", log_path, strerror(errno));
+    // The old log is a generation behind the board now, so anything appended
+    // to it would be ignored. Without it, the next append starts a new one.
+    if (unlink(log_path) != 0 && errno != ENOENT) {
+      log_error("Unable to remove %s: %s", log_path, strerror(errno));
+    }
+  }
+  return true;
+}
+
+/**
+ * Appends records to the log, starting a new one for the board file on
+ * disk if there isn't one
+ */
+bool score_writer_save_records(const char* log_path, uint32_t generation,
+                               const unsigned char* records, size_t len) {
+  unsigned char header[LEADERBOARD_HEADER_SIZE];
+  leaderboard_encode_header(header, generation);
+  if (!atomic_file_append(log_path, header, sizeof(header), records, len)) {
+    log_error("Unable to save high scores to %s: %s", log_path, strerror(errno));
+    return false;
+  }
+  return true;
+}
+
+void* _score_writer_run(void* data) {
+  ScoreWriter* writer = (ScoreWriter*)data;
+  pthread_mutex_lock(&writer->lock);
+  while (true) {
+    while (writer->appends_len == 0 && writer->merge_board == NULL && !writer->stopping) {
+      pthread_cond_wait(&writer->changed, &writer->lock);
+    }
+    if (writer->appends_len == 0 && writer->merge_board == NULL) {
+      break;
+    }
+    LeaderboardFile* board = writer->merge_board;
+    Leaderboard* delta = writer->merge_delta;
+    int max_entries = writer->merge_max_entries;
+    unsigned char* appends = writer->appends;
+    size_t appends_len = writer->appends_len;
+    writer->merge_board = NULL;
+    writer->appends = writer->writing;
+    writer->appends_len = 0;
+    writer->writing = appends;
+    writer->busy = true;
+    writer->batches++;
+    // Room for more appends
+    pthread_cond_broadcast(&writer->changed);
+    pthread_mutex_unlock(&writer->lock);
+
+    LeaderboardFile* merged = NULL;
+    if (board != NULL) {
+      size_t len;
+      unsigned char* image = leaderboard_file_merge(board, delta, max_entries, board->generation + 1, &len);
+      merged = leaderboard_file_from_image(image, len);
+      leaderboard_file_close(board);
+      // Without the new board the old log still holds the merged entries,
+      // so keep appending to it
+      if (score_writer_save_board(writer->board_path, writer->log_path, merged)) {
+        writer->generation = merged->generation;
+      }
+    }
+    if (appends_len > 0) {
+      score_writer_save_records(writer->log_path, writer->generation, appends, appends_len);
+    }
+
+    pthread_mutex_lock(&writer->lock);
+    if (merged != NULL) {
+      writer->merged = merged;
+    }
+    writer->busy = false;
+    pthread_cond_broadcast(&writer->changed);
+  }
+  pthread_mutex_unlock(&writer->lock);
+  return NULL;
+}
+
+/**
+ * Starts a writer for the given delta log and board file, with the
+ * generation of the board file on disk. Returns NULL if the thread can't
+ * be started.
+ */
+ScoreWriter* score_writer_start(const char* log_path, const char* board_path, uint32_t generation) {
+  ScoreWriter* writer = malloc(sizeof(ScoreWriter));
+  pthread_mutex_init(&writer->lock, NULL);
+  pthread_cond_init(&writer->changed, NULL);
+  writer->log_path = strdup(log_path);
+  writer->board_path = strdup(board_path);
+  writer->appends = malloc(SCORE_WRITER_MAX_PENDING);
+  writer->appends_len = 0;
+  writer->writing = malloc(SCORE_WRITER_MAX_PENDING);
+  writer->merge_board = NULL;
+  writer->merge_delta = NULL;
+  writer->merged = NULL;
+  writer->generation = generation;
+  writer->busy = false;
+  writer->stopping = false;
+  writer->batches = 0;
+  if (pthread_create(&writer->thread, NULL, _score_writer_run, writer) != 0) {
+    pthread_mutex_destroy(&writer->lock);
+    pthread_cond_destroy(&writer->changed);
+    free(writer->log_path);
+    free(writer->board_path);
+    free(writer->appends);
+    free(writer->writing);
+    free(writer);
+    return NULL;
+  }
+  return writer;
+}
+
+/**
+ * Queues data to be appended to the log. len must be at most
+ * SCORE_WRITER_MAX_PENDING.
+ */
+void score_writer_append(ScoreWriter* writer, const unsigned char* data, size_t len) {
+  pthread_mutex_lock(&writer->lock);
+  while (writer->appends_len + len > SCORE_WRITER_MAX_PENDING) {
+    pthread_cond_wait(&writer->changed, &writer->lock);
+  }
+  memcpy(writer->appends + writer->appends_len, data, len);
+  writer->appends_len += len;
+  pthread_cond_broadcast(&writer->changed);
+  pthread_mutex_unlock(&writer->lock);
+}
+
+/**
+ * Queues a merge of delta into board, up to max_entries, to replace the
+ * board file along with a fresh log. Takes ownership of a reference to the
+ * board. The delta is read on the writer thread, so it must not change
+ * until the result is taken, and only one merge can wait at a time.
+ */
+void score_writer_merge(ScoreWriter* writer, LeaderboardFile* board, Leaderboard* delta, int max_entries) {
+  pthread_mutex_lock(&writer->lock);
+  writer->merge_board = board;
+  writer->merge_delta = delta;
+  writer->merge_max_entries = max_entries;
+  writer->appends_len = 0;
+  pthread_cond_broadcast(&writer->changed);
+  pthread_mutex_unlock(&writer->lock);
+}
+
+/**
+ * The merged board, once the last merge is done, whether or not it reached
+ * the disk. NULL while it is still being built. The caller gets the
+ * writer's reference to it.
+ */
+LeaderboardFile* score_writer_take_merged(ScoreWriter* writer) {
+  pthread_mutex_lock(&writer->lock);
+  LeaderboardFile* merged = writer->merged;
+  writer->merged = NULL;
+  pthread_mutex_unlock(&writer->lock);
+  return merged;
+}
+
+/**
+ * Waits until everything queued is on disk.
+ */
+void score_writer_flush(ScoreWriter* writer) {
+  pthread_mutex_lock(&writer->lock);
+  while (writer->appends_len > 0 || writer->merge_board != NULL || writer->busy) {
+    pthread_cond_wait(&writer->changed, &writer->lock);
+  }
+  pthread_mutex_unlock(&writer->lock);
+}
+
+/**
+ * Writes whatever is still queued, then stops the thread and frees the writer.
+ */
+void score_writer_stop(ScoreWriter* writer) {
+  pthread_mutex_lock(&writer->lock);
+  writer->stopping = true;
+  pthread_cond_broadcast(&writer->changed);
+  pthread_mutex_unlock(&writer->lock);
+  pthread_join(writer->thread, NULL);
+  log_debug("Score writer made %lu writes", writer->batches);
+  if (writer->merged != NULL) {
+    leaderboard_file_close(writer->merged);
+  }
+  pthread_mutex_destroy(&writer->lock);
+  pthread_cond_destroy(&writer->changed);
+  free(writer->log_path);
+  free(writer->board_path);
+  free(writer->appends);
+  free(writer->writing);
+  free(writer);
+}
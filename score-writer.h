@@ -0,0 +1,57 @@
+#ifndef SCORE_WRITER_H
+#define SCORE_WRITER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <pthread.h>
+
+#include "leaderboard-file.h"
+
+/* Score writer */
+/* Writes high scores on a background thread, so disk latency never holds up
+ * the game. Two kinds of work are queued: records to append to the delta
+ * log, and a merge of a full delta into the board. The writer builds the
+ * merged board, replaces the board file, starts a fresh log to go with it
+ * and hands the board back, so the game never spends time on a merge.
+ * Appends waiting together go out in one write and one sync. A merge
+ * supersedes the appends queued before it, as its delta already holds
+ * those entries. The board file is replaced before the log, so a crash in
+ * between leaves a log one generation behind, which is ignored. If the
+ * fresh log can't be written the old one is removed rather than appended
+ * to, and the next append starts the log over. At most
+ * SCORE_WRITER_MAX_PENDING bytes of appends wait; past that, appending
+ * waits for the disk rather than dropping scores. The saves themselves
+ * can also be made on the calling thread, without a writer.
+ */
+#define SCORE_WRITER_MAX_PENDING 65536
+
+typedef struct score_writer {
+  pthread_mutex_t lock;
+  pthread_cond_t changed;
+  pthread_t thread;
+  char* log_path;
+  char* board_path;
+  unsigned char* appends; // Waiting to be appended
+  size_t appends_len;
+  unsigned char* writing; // Being appended; swapped with appends
+  LeaderboardFile* merge_board; // Waiting to be merged with merge_delta, or NULL
+  Leaderboard* merge_delta;
+  int merge_max_entries;
+  LeaderboardFile* merged; // Result of the last merge, until taken
+  uint32_t generation; // Of the board file on disk, which the log has to match
+  bool busy;
+  bool stopping;
+  unsigned long batches; // Writes made, to compare with what was queued
+} ScoreWriter;
+
+ScoreWriter* score_writer_start(const char* log_path, const char* board_path, uint32_t generation);
+void score_writer_append(ScoreWriter*, const unsigned char* data, size_t len);
+void score_writer_merge(ScoreWriter*, LeaderboardFile* board, Leaderboard* delta, int max_entries);
+LeaderboardFile* score_writer_take_merged(ScoreWriter*);
+void score_writer_flush(ScoreWriter*);
+bool score_writer_save_board(const char* board_path, const char* log_path, LeaderboardFile* board);
+bool score_writer_save_records(const char* log_path, uint32_t generation,
+                               const unsigned char* records, size_t len);
+void score_writer_stop(ScoreWriter*);
+
+#endif
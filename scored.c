@@ -0,0 +1,411 @@
+#define _GNU_SOURCE // accept4
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "high-scores.h"
+#include "score-protocol.h"
+#include "log.h"
+
+/* Score server */
+/* Keeps one high score board for every game and simulator on the host and
+ * answers them over a Unix socket (see score-protocol.h). One thread serves
+ * every connection from an epoll loop: whatever a client has sent is
+ * answered in one go, all the replies in one write, so a client that
+ * pipelines its requests costs a couple of system calls per batch rather
+ * than per request. Saving happens on the high scores' writer thread.
+ *   snake-scored [--dir DIR] [--socket PATH]
+ * DIR defaults to ~/.snake and PATH to scores.sock in DIR.
+ */
+#define SCORED_MAX_EVENTS 64
+#define SCORED_READ_SIZE 65536
+// Past this many reply bytes unsent, a client's requests wait until it reads
+#define SCORED_MAX_OUTPUT (1 << 20)
+
+typedef struct scored_client {
+  int fd;
+  bool reading; // Watched for input, off while its output is backed up
+  bool writing; // Watched for room to send what is left of its output
+  ScoreBuffer in;
+  ScoreBuffer out;
+} ScoredClient;
+
+typedef struct scored {
+  int epoll_fd;
+  int listen_fd;
+  int signal_fd;
+  int spare_fd; // Given up to turn a connection away when out of descriptors
+  bool accepting; // Whether listen_fd is watched
+  ScoredClient** clients; // By file descriptor
+  int clients_size;
+  high_scores* scores;
+} Scored;
+
+/* Requests */
+
+void _scored_submit(Scored* server, ScoreReader* request, ScoreBuffer* out, uint32_t id) {
+  int count = score_reader_u16(request);
+  if (!request->ok || count > SCORE_PROTOCOL_MAX_BATCH ||
+      request->len - request->pos != (size_t)count * SCORE_PROTOCOL_ENTRY_SIZE) {
+    request->ok = false;
+    return;
+  }
+  size_t frame = score_buffer_begin_frame(out, SCORE_SUBMITTED, id);
+  score_buffer_put_u16(out, count);
+  for (int i = 0; i < count; i++) {
+    LeaderboardEntry entry;
+    score_reader_entry(request, &entry);
+    // Ties rank newest first, so this is where it goes in
+    int rank = high_scores_rank(server->scores, entry.points);
+    bool added = rank < HIGH_SCORES_BOARD_SIZE && high_scores_add_score(server->scores, entry.points, entry.name);
+    score_buffer_put_u32(out, added ? (uint32_t)rank : SCORE_PROTOCOL_NO_RANK);
+  }
+  score_buffer_end_frame(out, frame);
+}
+
+void _scored_rank(Scored* server, ScoreReader* request, ScoreBuffer* out, uint32_t id) {
+  uint32_t points = score_reader_u32(request);
+  if (!request->ok || request->pos != request->len || points > INT32_MAX) {
+    request->ok = false;
+    return;
+  }
+  size_t frame = score_buffer_begin_frame(out, SCORE_RANKED, id);
+  score_buffer_put_u32(out, high_scores_rank(server->scores, points));
+  score_buffer_put_u32(out, high_scores_count(server->scores));
+  score_buffer_end_frame(out, frame);
+}
+
+void _scored_top(Scored* server, ScoreReader* request, ScoreBuffer* out, uint32_t id) {
+  static LeaderboardEntry entries[SCORE_PROTOCOL_MAX_TOP];
+  int max = score_reader_u16(request);
+  if (!request->ok || request->pos != request->len || max > SCORE_PROTOCOL_MAX_TOP) {
+    request->ok = false;
+    return;
+  }
+  int count = high_scores_top(server->scores, entries, max);
+  size_t frame = score_buffer_begin_frame(out, SCORE_TOP_REPLY, id);
+  score_buffer_put_u16(out, count);
+  for (int i = 0; i < count; i++) {
+    score_buffer_put_entry(out, &entries[i]);
+  }
+  score_buffer_end_frame(out, frame);
+}
+
+/**
+ * Answers every whole request the client has sent, unless its replies are
+ * backed up. Returns false if one was malformed, after queueing an ERROR.
+ */
+bool _scored_answer(Scored* server, ScoredClient* client) {
+  size_t used = 0;
+  bool ok = true;
+  while (client->out.len < SCORED_MAX_OUTPUT) {
+    ScoreBuffer rest = {client->in.data + used, client->in.len - used, client->in.len - used};
+    ScoreReader request;
+    size_t frame_len;
+    if (!score_buffer_next_frame(&rest, &request, &frame_len)) {
+      if (!request.ok) {
+        // A length out of range; there's no request id to answer with
+        size_t frame = score_buffer_begin_frame(&client->out, SCORE_ERROR, 0);
+        score_buffer_end_frame(&client->out, frame);
+        ok = false;
+      }
+      break;
+    }
+    used += frame_len;
+    int type = score_reader_u8(&request);
+    uint32_t id = score_reader_u32(&request);
+    switch (type) {
+      case SCORE_SUBMIT:
+        _scored_submit(server, &request, &client->out, id);
+        break;
+      case SCORE_RANK:
+        _scored_rank(server, &request, &client->out, id);
+        break;
+      case SCORE_TOP:
+        _scored_top(server, &request, &client->out, id);
+        break;
+      default:
+        request.ok = false;
+    }
+    if (!request.ok) {
+      size_t frame = score_buffer_begin_frame(&client->out, SCORE_ERROR, id);
+      score_buffer_end_frame(&client->out, frame);
+      ok = false;
+      break;
+    }
+  }
+  score_buffer_consume(&client->in, used);
+  return ok;
+}
+
+/* Connections */
+
+void _scored_watch(Scored* server, ScoredClient* client) {
+  struct epoll_event event;
+  event.events = (client->reading ? EPOLLIN : 0) | (client->writing ? EPOLLOUT : 0);
+  event.data.fd = client->fd;
+  epoll_ctl(server->epoll_fd, EPOLL_CTL_MOD, client->fd, &event);
+}
+
+void _scored_watch_listener(Scored* server, bool accepting) {
+  if (accepting == server->accepting) {
+    return;
+  }
+  struct epoll_event event = {EPOLLIN, {.fd = server->listen_fd}};
+  epoll_ctl(server->epoll_fd, accepting ? EPOLL_CTL_ADD : EPOLL_CTL_DEL, server->listen_fd, &event);
+  server->accepting = accepting;
+}
+
+void _scored_drop(Scored* server, ScoredClient* client) {
+  epoll_ctl(server->epoll_fd, EPOLL_CTL_DEL, client->fd, NULL);
+  close(client->fd);
+  server->clients[client->fd] = NULL;
+  score_buffer_free(&client->in);
+  score_buffer_free(&client->out);
+  free(client);
+  // A descriptor is free again
+  if (server->spare_fd < 0) {
+    server->spare_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+  }
+  _scored_watch_listener(server, true);
+}
+
+/**
+ * Sends as much of the client's output as the socket takes. Returns false
+ * if the client has gone.
+ */
+bool _scored_flush(ScoredClient* client) {
+  size_t sent = 0;
+  while (sent < client->out.len) {
+    ssize_t wrote = send(client->fd, client->out.data + sent, client->out.len - sent, MSG_NOSIGNAL);
+    if (wrote < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        return false;
+      }
+      break;
+    }
+    sent += wrote;
+  }
+  score_buffer_consume(&client->out, sent);
+  return true;
+}
+
+/**
+ * Out of descriptors, so the connection waiting can't be accepted, and the
+ * listener would stay ready forever. Closes it using the spare descriptor,
+ * or failing that stops listening until a client goes.
+ */
+void _scored_turn_away(Scored* server) {
+  log_warn("Out of file descriptors; turning a connection away");
+  if (server->spare_fd >= 0) {
+    close(server->spare_fd);
+    int fd = accept4(server->listen_fd, NULL, NULL, SOCK_CLOEXEC);
+    if (fd >= 0) {
+      close(fd);
+    }
+    server->spare_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+  }
+  if (server->spare_fd < 0) {
+    _scored_watch_listener(server, false);
+  }
+}
+
+void _scored_accept(Scored* server) {
+  int fd;
+  while ((fd = accept4(server->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+    if (fd >= server->clients_size) {
+      int size = server->clients_size * 2 > fd ? server->clients_size * 2 : fd + 1;
+      server->clients = realloc(server->clients, sizeof(ScoredClient*) * size);
+      memset(server->clients + server->clients_size, 0, sizeof(ScoredClient*) * (size - server->clients_size));
+      server->clients_size = size;
+    }
+    ScoredClient* client = malloc(sizeof(ScoredClient));
+    client->fd = fd;
+    client->reading = true;
+    client->writing = false;
+    score_buffer_init(&client->in);
+    score_buffer_init(&client->out);
+    server->clients[fd] = client;
+    struct epoll_event event = {EPOLLIN, {.fd = fd}};
+    epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, fd, &event);
+  }
+  if (errno == EMFILE || errno == ENFILE) {
+    _scored_turn_away(server);
+  } else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+    log_warn("Unable to accept a connection: %s", strerror(errno));
+  }
+}
+
+void _scored_serve(Scored* server, ScoredClient* client, uint32_t events) {
+  bool open = _scored_flush(client);
+  if (open && events & EPOLLIN) {
+    score_buffer_reserve(&client->in, SCORED_READ_SIZE);
+    ssize_t got = recv(client->fd, client->in.data + client->in.len, client->in.cap - client->in.len, 0);
+    if (got > 0) {
+      client->in.len += got;
+    } else if (got == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+      open = false;
+    }
+  } else if (events & (EPOLLHUP | EPOLLERR)) {
+    open = false;
+  }
+  // Requests held back by a full output buffer are answered as it drains
+  if (open && !_scored_answer(server, client)) {
+    log_warn("Dropping a client that sent a malformed request");
+    _scored_flush(client);
+    open = false;
+  }
+  if (!open || !_scored_flush(client)) {
+    _scored_drop(server, client);
+    return;
+  }
+  bool reading = client->out.len < SCORED_MAX_OUTPUT;
+  bool writing = client->out.len > 0;
+  if (reading != client->reading || writing != client->writing) {
+    client->reading = reading;
+    client->writing = writing;
+    _scored_watch(server, client);
+  }
+}
+
+/* Startup */
+
+/**
+ * Listens on path, taking it over from a server that has died without
+ * removing it. Returns -1 if another server is still listening there.
+ */
+int _scored_listen(const char* path) {
+  struct sockaddr_un address;
+  if (strlen(path) >= sizeof(address.sun_path)) {
+    log_error("Socket path %s is too long", path);
+    return -1;
+  }
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  strcpy(address.sun_path, path);
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    log_error("Unable to create a socket: %s", strerror(errno));
+    return -1;
+  }
+  int bound = bind(fd, (struct sockaddr*)&address, sizeof(address));
+  if (bound != 0 && errno == EADDRINUSE) {
+    int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    bool live = connect(probe, (struct sockaddr*)&address, sizeof(address)) == 0;
+    close(probe);
+    if (live) {
+      log_error("Another server is listening on %s", path);
+      close(fd);
+      return -1;
+    }
+    unlink(path);
+    bound = bind(fd, (struct sockaddr*)&address, sizeof(address));
+  }
+  if (bound != 0 || listen(fd, SOMAXCONN) != 0) {
+    log_error("Unable to listen on %s: %s", path, strerror(errno));
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+int main(int argc, char** argv) {
+  const char* dir = high_scores_default_dir();
+  const char* socket_path = NULL;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--dir") == 0 && i + 1 < argc) {
+      dir = argv[++i];
+    } else if (strcmp(argv[i], "--socket") == 0 && i + 1 < argc) {
+      socket_path = argv[++i];
+    } else {
+      printf("Usage: %s [--dir DIR] [--socket PATH]\n", argv[0]);
+      return 1;
+    }
+  }
+  if (dir == NULL) {
+    log_error("No home directory; use --dir");
+    return 1;
+  }
+  char default_socket[4096];
+  if (socket_path == NULL) {
+    snprintf(default_socket, sizeof(default_socket), "%s/%s", dir, SCORE_PROTOCOL_SOCKET_FILE);
+    socket_path = default_socket;
+  }
+  // Blocked before any thread starts, so only signal_fd sees them
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  sigprocmask(SIG_BLOCK, &signals, NULL);
+  log_start();
+  atexit(log_stop);
+
+  Scored server;
+  server.scores = high_scores_load(dir);
+  high_scores_start_writer(server.scores);
+  server.listen_fd = _scored_listen(socket_path);
+  if (server.listen_fd < 0) {
+    high_scores_free(server.scores);
+    return 1;
+  }
+  server.signal_fd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+  server.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  server.clients_size = 64;
+  server.clients = calloc(server.clients_size, sizeof(ScoredClient*));
+  server.spare_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+  server.accepting = false;
+  _scored_watch_listener(&server, true);
+  struct epoll_event event = {EPOLLIN, {.fd = server.signal_fd}};
+  epoll_ctl(server.epoll_fd, EPOLL_CTL_ADD, server.signal_fd, &event);
+  log_info("Serving %d high scores on %s", high_scores_count(server.scores), socket_path);
+
+  bool running = true;
+  struct epoll_event events[SCORED_MAX_EVENTS];
+  while (running) {
+    int ready = epoll_wait(server.epoll_fd, events, SCORED_MAX_EVENTS, -1);
+    if (ready < 0 && errno != EINTR) {
+      log_error("epoll_wait failed: %s", strerror(errno));
+      break;
+    }
+    for (int i = 0; i < ready; i++) {
+      int fd = events[i].data.fd;
+      if (fd == server.listen_fd) {
+        _scored_accept(&server);
+      } else if (fd == server.signal_fd) {
+        running = false;
+      } else if (fd < server.clients_size && server.clients[fd] != NULL) {
+        _scored_serve(&server, server.clients[fd], events[i].events);
+      }
+    }
+  }
+
+  log_info("Shutting down");
+  for (int fd = 0; fd < server.clients_size; fd++) {
+    if (server.clients[fd] != NULL) {
+      _scored_drop(&server, server.clients[fd]);
+    }
+  }
+  free(server.clients);
+  close(server.listen_fd);
+  unlink(socket_path);
+  close(server.signal_fd);
+  if (server.spare_fd >= 0) {
+    close(server.spare_fd);
+  }
+  close(server.epoll_fd);
+  // Waits for the writer to save everything queued
+  high_scores_free(server.scores);
+  return 0;
+}
@@ -0,0 +1,81 @@
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "game.h"
+#include "autopilot.h"
+#include "score-client.h"
+
+/* Headless simulation */
+/* Runs games back to back with the autopilot, as fast as possible, and
+ * reports how many ticks per second the simulation core manages. Given a
+ * score server's socket, it also submits every game's score to it, in
+ * batches of SIM_SUBMIT_BATCH, under the name SIM_NAME.
+ *   snake-sim [ticks] [seed] [score server socket]
+ */
+
+#define SIM_DEFAULT_TICKS 10000000
+#define SIM_SUBMIT_BATCH 256
+#define SIM_NAME "SIM"
+
+double sim_seconds() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+int main(int argc, char** argv) {
+  unsigned long ticks = argc > 1 ? strtoul(argv[1], NULL, 10) : SIM_DEFAULT_TICKS;
+  uint64_t seed = argc > 2 ? strtoull(argv[2], NULL, 10) : (uint64_t)time(NULL);
+
+  ScoreClient* client = NULL;
+  if (argc > 3 && (client = score_client_connect(argv[3])) == NULL) {
+    fprintf(stderr, "Unable to reach a score server on %s\n", argv[3]);
+    return 1;
+  }
+  LeaderboardEntry batch[SIM_SUBMIT_BATCH];
+  int batched = 0;
+
+  Game* game = game_init(50, 50, seed);
+  unsigned long games = 0;
+  unsigned long berries = 0;
+
+  double start = sim_seconds();
+  unsigned long ticks_run = 0;
+  while (ticks_run < ticks) {
+    ticks_run += autopilot_play(game, ticks - ticks_run);
+    if (game->gameOver) {
+      games++;
+      berries += game->snake->berriesEaten;
+      if (client != NULL) {
+        strcpy(batch[batched].name, SIM_NAME);
+        batch[batched++].points = game_score(game);
+      }
+      game_reset(game);
+    }
+    if (batched == SIM_SUBMIT_BATCH || (batched > 0 && ticks_run >= ticks)) {
+      if (!score_client_submit(client, batch, batched, NULL)) {
+        fprintf(stderr, "Lost the score server\n");
+        return 1;
+      }
+      batched = 0;
+    }
+  }
+  double elapsed = sim_seconds() - start;
+
+  printf("seed: %llu ticks: %lu games: %lu berries: %lu seconds: %.3f ticks/s: %.0f\n",
+         (unsigned long long)seed, ticks, games, berries, elapsed, ticks / elapsed);
+  if (client != NULL) {
+    // Answered after every submit before it, so the board is complete
+    int points = 0;
+    int rank, count;
+    if (score_client_ranks(client, &points, 1, &rank, &count)) {
+      printf("submitted: %lu board: %d\n", games, count);
+    }
+    score_client_close(client);
+  }
+  game_free(game);
+  return 0;
+}
@@ -0,0 +1,146 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "text-atlas.h"
+#include "font-cache.h"
+#include "hash.h"
+#include "profile.h"
+
+/* Glyph atlases are built on first use and cached per (path, size, fg, bg) */
+struct hash* text_atlases = NULL;
+
+void _text_atlas_key(char* key, size_t len, const char* path, int size, SDL_Color fg, SDL_Color bg) {
+  snprintf(key, len, "%d:%d,%d,%d:%d,%d,%d:%s", size, fg.r, fg.g, fg.b, bg.r, bg.g, bg.b, path);
+}
+
+TextAtlas* _text_atlas_build(TTF_Font* font, SDL_Color fg, SDL_Color bg) {
+  SDL_Surface* rendered[TEXT_ATLAS_GLYPHS];
+  int width = 0;
+  int height = TTF_FontHeight(font);
+  for (int i = 0; i < TEXT_ATLAS_GLYPHS; i++) {
+    char str[] = {TEXT_ATLAS_FIRST_CHAR + i, 0};
+    rendered[i] = TTF_RenderText_Shaded(font, str, fg, bg);
+    if (rendered[i] != NULL) {
+      width += rendered[i]->w;
+      if (rendered[i]->h > height) {
+        height = rendered[i]->h;
+      }
+    } else {
+      // Blank glyphs (the space) may not render; keep their advance
+      int advance = 0;
+      TTF_GlyphMetrics(font, TEXT_ATLAS_FIRST_CHAR + i, NULL, NULL, NULL, NULL, &advance);
+      width += advance;
+    }
+  }
+
+  SDL_Surface* strip = SDL_CreateRGBSurface(SDL_SWSURFACE, width, height, 32, 0, 0, 0, 0);
+  if (strip == NULL) {
+    for (int i = 0; i < TEXT_ATLAS_GLYPHS; i++) {
+      SDL_FreeSurface(rendered[i]);
+    }
+    return NULL;
+  }
+  SDL_FillRect(strip, NULL, SDL_MapRGB(strip->format, bg.r, bg.g, bg.b));
+
+  TextAtlas* atlas = malloc(sizeof(TextAtlas));
+  atlas->height = height;
+  int x = 0;
+  for (int i = 0; i < TEXT_ATLAS_GLYPHS; i++) {
+    SDL_Rect* glyph = &atlas->glyphs[i];
+    glyph->x = x;
+    glyph->y = 0;
+    glyph->h = height;
+    if (rendered[i] != NULL) {
+      glyph->w = rendered[i]->w;
+      SDL_Rect loc = {x, 0, 0, 0};
+      SDL_BlitSurface(rendered[i], NULL, strip, &loc);
+      SDL_FreeSurface(rendered[i]);
+    } else {
+      int advance = 0;
+      TTF_GlyphMetrics(font, TEXT_ATLAS_FIRST_CHAR + i, NULL, NULL, NULL, NULL, &advance);
+      glyph->w = advance;
+    }
+    x += glyph->w;
+  }
+
+  // Match the screen's pixel format so glyph blits are straight copies
+  atlas->surface = SDL_DisplayFormat(strip);
+  if (atlas->surface == NULL) {
+    atlas->surface = strip;
+  } else {
+    SDL_FreeSurface(strip);
+  }
+  return atlas;
+}
+
+/**
+ * Returns the atlas for a font and colour pair, building it on first use.
+ * Returns NULL if the font can't be opened.
+ */
+TextAtlas* text_atlas_get(const char* path, int size, SDL_Color fg, SDL_Color bg) {
+  if (text_atlases == NULL) {
+    text_atlases = hash_init();
+  }
+  char key[512];
+  _text_atlas_key(key, sizeof(key), path, size, fg, bg);
+  TextAtlas* atlas = (TextAtlas*)hash_at(text_atlases, key);
+  if (atlas == NULL) {
+    TTF_Font* font = font_cache_get(path, size);
+    if (font == NULL) {
+      return NULL;
+    }
+    atlas = _text_atlas_build(font, fg, bg);
+    if (atlas == NULL) {
+      return NULL;
+    }
+    hash_add(text_atlases, key, atlas);
+  }
+  return atlas;
+}
+
+SDL_Rect* _text_atlas_glyph(TextAtlas* atlas, char c) {
+  if (c < TEXT_ATLAS_FIRST_CHAR || c > TEXT_ATLAS_LAST_CHAR) {
+    c = '?';
+  }
+  return &atlas->glyphs[c - TEXT_ATLAS_FIRST_CHAR];
+}
+
+int text_atlas_width(TextAtlas* atlas, const char* str) {
+  int width = 0;
+  for (; *str != '\0'; str++) {
+    width += _text_atlas_glyph(atlas, *str)->w;
+  }
+  return width;
+}
+
+/**
+ * Draws str with its top left corner at (x, y). Returns the width drawn.
+ */
+int text_atlas_draw(TextAtlas* atlas, SDL_Surface* screen, const char* str, int x, int y) {
+  int start = x;
+  for (; *str != '\0'; str++) {
+    SDL_Rect* glyph = _text_atlas_glyph(atlas, *str);
+    SDL_Rect loc = {x, y, 0, 0};
+    SDL_BlitSurface(atlas->surface, glyph, screen, &loc);
+    PROFILE_COUNT(PROFILE_BLITS, 1);
+    x += glyph->w;
+  }
+  return x - start;
+}
+
+void text_atlas_free() {
+  if (text_atlases == NULL) {
+    return;
+  }
+  int index = 0;
+  const char* key;
+  void* data;
+  while (hash_next(text_atlases, &index, &key, &data)) {
+    TextAtlas* atlas = (TextAtlas*)data;
+    SDL_FreeSurface(atlas->surface);
+    free(atlas);
+  }
+  hash_free(text_atlases);
+  text_atlases = NULL;
+}
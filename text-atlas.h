@@ -0,0 +1,26 @@
+#ifndef TEXT_ATLAS_H
+#define TEXT_ATLAS_H
+
+#include <SDL/SDL.h>
+
+/* Glyph atlas */
+/* Every printable ASCII glyph of a font is rendered once, in one colour pair,
+ * into a single strip surface. Strings are drawn by blitting glyph rects out
+ * of the strip, so drawing text allocates nothing.
+ */
+#define TEXT_ATLAS_FIRST_CHAR ' '
+#define TEXT_ATLAS_LAST_CHAR '~'
+#define TEXT_ATLAS_GLYPHS (TEXT_ATLAS_LAST_CHAR - TEXT_ATLAS_FIRST_CHAR + 1)
+
+typedef struct text_atlas {
+  SDL_Surface* surface;
+  SDL_Rect glyphs[TEXT_ATLAS_GLYPHS];
+  int height;
+} TextAtlas;
+
+TextAtlas* text_atlas_get(const char* path, int size, SDL_Color fg, SDL_Color bg);
+int text_atlas_width(TextAtlas*, const char* str);
+int text_atlas_draw(TextAtlas*, SDL_Surface* screen, const char* str, int x, int y);
+void text_atlas_free();
+
+#endif
@@ -0,0 +1,168 @@
+#include <stdlib.h>
+#include <limits.h>
+
+#include "timer-wheel.h"
+
+void timer_init(Timer* timer, TimerCallback callback, void* data) {
+  timer->due = 0;
+  timer->callback = callback;
+  timer->data = data;
+  timer->scheduled = false;
+  timer->prev = NULL;
+  timer->next = NULL;
+}
+
+TimerWheel* timer_wheel_init() {
+  TimerWheel* wheel = malloc(sizeof(struct timer_wheel));
+  for (int i = 0; i < TIMER_WHEEL_SLOTS; i++) {
+    wheel->slots[i] = NULL;
+  }
+  wheel->now = 0;
+  wheel->count = 0;
+  wheel->paused = false;
+  wheel->next_due = ULONG_MAX;
+  wheel->next_due_known = true;
+  return wheel;
+}
+
+Timer** _timer_wheel_slot(TimerWheel* wheel, unsigned long tick) {
+  return &wheel->slots[tick & (TIMER_WHEEL_SLOTS - 1)];
+}
+
+/**
+ * Fires the timer delay ticks from now, at least one tick ahead.
+ * A timer that is already scheduled is moved.
+ */
+void timer_wheel_schedule(TimerWheel* wheel, Timer* timer, unsigned long delay) {
+  if (timer->scheduled) {
+    timer_wheel_cancel(wheel, timer);
+  }
+  timer->due = wheel->now + (delay > 0 ? delay : 1);
+  Timer** slot = _timer_wheel_slot(wheel, timer->due);
+  timer->prev = NULL;
+  timer->next = *slot;
+  if (*slot != NULL) {
+    (*slot)->prev = timer;
+  }
+  *slot = timer;
+  timer->scheduled = true;
+  wheel->count++;
+  if (wheel->next_due_known && timer->due < wheel->next_due) {
+    wheel->next_due = timer->due;
+  }
+}
+
+void timer_wheel_cancel(TimerWheel* wheel, Timer* timer) {
+  if (!timer->scheduled) {
+    return;
+  }
+  if (timer->prev != NULL) {
+    timer->prev->next = timer->next;
+  } else {
+    *_timer_wheel_slot(wheel, timer->due) = timer->next;
+  }
+  if (timer->next != NULL) {
+    timer->next->prev = timer->prev;
+  }
+  timer->prev = NULL;
+  timer->next = NULL;
+  timer->scheduled = false;
+  wheel->count--;
+  if (timer->due == wheel->next_due) {
+    wheel->next_due_known = false;
+  }
+}
+
+unsigned long _timer_wheel_find_next_due(TimerWheel* wheel) {
+  if (wheel->count == 0) {
+    return ULONG_MAX;
+  }
+  // Walk one turn of the wheel; timers due further out wait in the same
+  // slots, so keep the earliest of those in case nothing is due this turn
+  unsigned long next = ULONG_MAX;
+  for (unsigned long tick = wheel->now + 1; tick <= wheel->now + TIMER_WHEEL_SLOTS; tick++) {
+    for (Timer* timer = *_timer_wheel_slot(wheel, tick); timer != NULL; timer = timer->next) {
+      if (timer->due == tick) {
+        return tick;
+      }
+      if (timer->due < next) {
+        next = timer->due;
+      }
+    }
+  }
+  return next;
+}
+
+/**
+ * The wheel tick of the earliest scheduled timer, or ULONG_MAX if there is
+ * none or the wheel is paused.
+ */
+unsigned long timer_wheel_next_due(TimerWheel* wheel) {
+  if (wheel->paused) {
+    return ULONG_MAX;
+  }
+  if (!wheel->next_due_known) {
+    wheel->next_due = _timer_wheel_find_next_due(wheel);
+    wheel->next_due_known = true;
+  }
+  return wheel->next_due;
+}
+
+/**
+ * Moves the clock forward, firing timers in due order as it passes them.
+ * Callbacks may schedule or cancel timers, including the one firing.
+ */
+void timer_wheel_advance(TimerWheel* wheel, unsigned long ticks) {
+  if (wheel->paused) {
+    return;
+  }
+  unsigned long end = wheel->now + ticks;
+  while (wheel->now < end) {
+    unsigned long due = timer_wheel_next_due(wheel);
+    if (due > end) {
+      wheel->now = end;
+      return;
+    }
+    wheel->now = due;
+    Timer** slot = _timer_wheel_slot(wheel, due);
+    Timer* timer = *slot;
+    while (timer != NULL) {
+      if (timer->due != due) {
+        timer = timer->next;
+        continue;
+      }
+      timer_wheel_cancel(wheel, timer);
+      timer->callback(timer->data);
+      // The callback may have changed this slot, start over
+      timer = *slot;
+    }
+  }
+}
+
+void timer_wheel_pause(TimerWheel* wheel) {
+  wheel->paused = true;
+}
+
+void timer_wheel_resume(TimerWheel* wheel) {
+  wheel->paused = false;
+}
+
+/**
+ * Cancels every timer and winds the clock back to zero
+ */
+void timer_wheel_reset(TimerWheel* wheel) {
+  for (int i = 0; i < TIMER_WHEEL_SLOTS; i++) {
+    while (wheel->slots[i] != NULL) {
+      timer_wheel_cancel(wheel, wheel->slots[i]);
+    }
+  }
+  wheel->now = 0;
+  wheel->paused = false;
+  wheel->next_due = ULONG_MAX;
+  wheel->next_due_known = true;
+}
+
+void timer_wheel_free(TimerWheel* wheel) {
+  timer_wheel_reset(wheel);
+  free(wheel);
+}
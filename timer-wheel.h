@@ -0,0 +1,49 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdbool.h>
+
+/* Timer wheel */
+/* One-shot timers on a logical clock of ticks. The wheel only moves when its
+ * owner advances it, so callbacks run on the owner's thread. Timers hang off
+ * one of TIMER_WHEEL_SLOTS lists by due tick, which makes scheduling and
+ * cancelling O(1). Timers are owned by the caller, usually embedded in the
+ * struct they act on, so the wheel never allocates after timer_wheel_init.
+ * Pausing the wheel freezes its clock: advancing does nothing, so timers keep
+ * the time they had left until the wheel is resumed.
+ */
+#define TIMER_WHEEL_SLOTS 256 // Power of two
+
+typedef void (*TimerCallback)(void* data);
+
+typedef struct timer {
+  unsigned long due;
+  TimerCallback callback;
+  void* data;
+  bool scheduled;
+  struct timer* prev;
+  struct timer* next;
+} Timer;
+
+typedef struct timer_wheel {
+  Timer* slots[TIMER_WHEEL_SLOTS];
+  unsigned long now;
+  int count;
+  bool paused;
+  // Earliest due tick, worked out again only when that timer goes away
+  unsigned long next_due;
+  bool next_due_known;
+} TimerWheel;
+
+void timer_init(Timer*, TimerCallback, void* data);
+TimerWheel* timer_wheel_init();
+void timer_wheel_schedule(TimerWheel*, Timer*, unsigned long delay);
+void timer_wheel_cancel(TimerWheel*, Timer*);
+unsigned long timer_wheel_next_due(TimerWheel*);
+void timer_wheel_advance(TimerWheel*, unsigned long ticks);
+void timer_wheel_pause(TimerWheel*);
+void timer_wheel_resume(TimerWheel*);
+void timer_wheel_reset(TimerWheel*);
+void timer_wheel_free(TimerWheel*);
+
+#endif